@@ -0,0 +1,284 @@
+//
+//  AllocTrack.c
+//
+
+#define UI_ALLOC_TRACK_INTERNAL
+#include <NdkBootPicker.h>
+
+#ifndef MDEPKG_NDEBUG
+
+STATIC
+NDK_UI_ALLOCATION
+mAllocations[UI_ALLOC_TRACK_MAX];
+
+STATIC
+UINTN
+mAllocationCount = 0;
+
+STATIC
+NDK_UI_ALLOC_SITE
+mAllocSites[UI_ALLOC_SITE_MAX];
+
+STATIC
+UINTN
+mAllocSiteCount = 0;
+
+STATIC
+NDK_UI_ALLOC_STATS
+mAllocStats;
+
+STATIC
+NDK_UI_ALLOC_SITE *
+FindAllocSite (
+  IN CONST CHAR8       *File,
+  IN UINT32            Line
+  )
+{
+  UINTN                Index;
+  NDK_UI_ALLOC_SITE    *Site;
+  
+  for (Index = 0; Index < mAllocSiteCount; ++Index) {
+    if (mAllocSites[Index].Line == Line && mAllocSites[Index].File == File) {
+      return &mAllocSites[Index];
+    }
+  }
+  
+  if (mAllocSiteCount == UI_ALLOC_SITE_MAX) {
+    return NULL;
+  }
+  
+  Site = &mAllocSites[mAllocSiteCount++];
+  ZeroMem (Site, sizeof (*Site));
+  Site->File = File;
+  Site->Line = Line;
+  return Site;
+}
+
+STATIC
+NDK_UI_ALLOCATION *
+FindAllocation (
+  IN VOID              *Buffer
+  )
+{
+  UINTN                Index;
+  
+  //
+  // Short lived buffers are freed soon after they are allocated, search from the newest.
+  //
+  for (Index = mAllocationCount; Index > 0; --Index) {
+    if (mAllocations[Index - 1].Buffer == Buffer) {
+      return &mAllocations[Index - 1];
+    }
+  }
+  
+  return NULL;
+}
+
+STATIC
+VOID
+AddSiteBytes (
+  IN NDK_UI_ALLOC_SITE *Site,
+  IN UINTN             Size
+  )
+{
+  ++Site->Allocations;
+  ++Site->Live;
+  Site->LiveBytes += Size;
+  Site->PeakBytes = MAX (Site->PeakBytes, Site->LiveBytes);
+}
+
+STATIC
+VOID
+RecordAllocation (
+  IN VOID              *Buffer,
+  IN UINTN             Size,
+  IN CONST CHAR8       *File,
+  IN UINT32            Line
+  )
+{
+  NDK_UI_ALLOC_SITE    *Site;
+  
+  Site = FindAllocSite (File, Line);
+  if (Site == NULL || mAllocationCount == UI_ALLOC_TRACK_MAX) {
+    ++mAllocStats.Untracked;
+    return;
+  }
+  
+  mAllocations[mAllocationCount].Buffer = Buffer;
+  mAllocations[mAllocationCount].Size = Size;
+  mAllocations[mAllocationCount].Site = Site;
+  ++mAllocationCount;
+  
+  AddSiteBytes (Site, Size);
+  ++mAllocStats.Allocations;
+  mAllocStats.BytesInUse += Size;
+  mAllocStats.PeakBytes = MAX (mAllocStats.PeakBytes, mAllocStats.BytesInUse);
+}
+
+STATIC
+VOID
+RetagAllocation (
+  IN VOID              *Buffer,
+  IN CONST CHAR8       *File,
+  IN UINT32            Line
+  )
+{
+  NDK_UI_ALLOCATION    *Allocation;
+  NDK_UI_ALLOC_SITE    *Site;
+  
+  Allocation = FindAllocation (Buffer);
+  if (Allocation == NULL) {
+    return;
+  }
+  
+  Site = FindAllocSite (File, Line);
+  if (Site == NULL) {
+    return;
+  }
+  
+  --Allocation->Site->Allocations;
+  --Allocation->Site->Live;
+  Allocation->Site->LiveBytes -= Allocation->Size;
+  Allocation->Site = Site;
+  AddSiteBytes (Site, Allocation->Size);
+}
+
+VOID *
+TrackAllocatePool (
+  IN UINTN             Size,
+  IN BOOLEAN           Zero,
+  IN CONST CHAR8       *File,
+  IN UINT32            Line
+  )
+{
+  VOID                 *Buffer;
+  
+  Buffer = Zero ? AllocateZeroPool (Size) : AllocatePool (Size);
+  if (Buffer != NULL) {
+    RecordAllocation (Buffer, Size, File, Line);
+  }
+  
+  return Buffer;
+}
+
+VOID
+TrackFreePool (
+  IN VOID              *Buffer
+  )
+{
+  NDK_UI_ALLOCATION    *Allocation;
+  
+  //
+  // Buffers handed out by libraries were never recorded and are simply released.
+  //
+  Allocation = FindAllocation (Buffer);
+  if (Allocation != NULL) {
+    --Allocation->Site->Live;
+    Allocation->Site->LiveBytes -= Allocation->Size;
+    mAllocStats.BytesInUse -= Allocation->Size;
+    ++mAllocStats.Frees;
+    *Allocation = mAllocations[--mAllocationCount];
+  }
+  
+  FreePool (Buffer);
+}
+
+NDK_UI_IMAGE *
+TrackCreateImage (
+  IN UINT16            Width,
+  IN UINT16            Height,
+  IN BOOLEAN           IsAlpha,
+  IN CONST CHAR8       *File,
+  IN UINT32            Line
+  )
+{
+  NDK_UI_IMAGE         *Image;
+  
+  //
+  // Book both pool allocations of the image to the caller rather than to CreateImage.
+  //
+  Image = CreateImage (Width, Height, IsAlpha);
+  if (Image != NULL) {
+    RetagAllocation (Image->Bitmap, File, Line);
+    RetagAllocation (Image, File, Line);
+  }
+  
+  return Image;
+}
+
+#endif
+
+CHAR8 *
+AllocationReport (
+  OUT UINTN            *ReportSize
+  )
+{
+#ifndef MDEPKG_NDEBUG
+  CHAR8                *Report;
+  UINTN                BufferSize;
+  UINTN                Length;
+  UINTN                Index;
+  NDK_UI_ALLOC_SITE    *Site;
+  
+  *ReportSize = 0;
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Allocations %u, frees %u, untracked %u, in use %u bytes, peak %u bytes\n",
+          (UINT32) mAllocStats.Allocations,
+          (UINT32) mAllocStats.Frees,
+          (UINT32) mAllocStats.Untracked,
+          (UINT32) mAllocStats.BytesInUse,
+          (UINT32) mAllocStats.PeakBytes
+          ));
+  
+  BufferSize = (mAllocSiteCount + 2) * UI_ALLOC_TRACK_LINE;
+  Report = AllocateZeroPool (BufferSize);
+  if (Report == NULL) {
+    return NULL;
+  }
+  
+  Length = AsciiSPrint (Report, BufferSize, "File,Line,Allocations,Live,LiveBytes,PeakBytes\n");
+  
+  for (Index = 0; Index < mAllocSiteCount; ++Index) {
+    Site = &mAllocSites[Index];
+    if (Site->Allocations == 0) {
+      continue;
+    }
+  
+    if (Site->Live != 0) {
+      DEBUG ((DEBUG_INFO, "OCUI: Leak at %a:%u - %u allocations, %u bytes\n",
+              Site->File,
+              Site->Line,
+              (UINT32) Site->Live,
+              (UINT32) Site->LiveBytes
+              ));
+    }
+  
+    Length += AsciiSPrint (Report + Length,
+                           BufferSize - Length,
+                           "%a,%u,%u,%u,%u,%u\n",
+                           Site->File,
+                           Site->Line,
+                           (UINT32) Site->Allocations,
+                           (UINT32) Site->Live,
+                           (UINT32) Site->LiveBytes,
+                           (UINT32) Site->PeakBytes
+                           );
+  }
+  
+  Length += AsciiSPrint (Report + Length,
+                         BufferSize - Length,
+                         "Total,0,%u,%u,%u,%u\n",
+                         (UINT32) mAllocStats.Allocations,
+                         (UINT32) mAllocationCount,
+                         (UINT32) mAllocStats.BytesInUse,
+                         (UINT32) mAllocStats.PeakBytes
+                         );
+  
+  *ReportSize = Length;
+  
+  return Report;
+#else
+  *ReportSize = 0;
+  return NULL;
+#endif
+}
@@ -0,0 +1,231 @@
+//
+//  Animation.c
+//
+
+#include <NdkBootPicker.h>
+
+STATIC
+EFI_EVENT
+mAnimationEvent = NULL;
+
+STATIC
+NDK_UI_ANIMATION
+mAnimations[UI_ANIMATION_MAX];
+
+STATIC
+UINTN
+mAnimationCount = 0;
+
+STATIC
+UINT64
+mLastFrameTime = 0;
+
+STATIC
+UINT64
+mNextFrameTime = 0;
+
+STATIC
+NDK_UI_FRAME_STATS
+mFrameStats;
+
+EFI_STATUS
+InitAnimation (
+  VOID
+  )
+{
+  EFI_STATUS         Status;
+  
+  if (mAnimationEvent != NULL) {
+    return EFI_SUCCESS;
+  }
+  
+  ZeroMem (&mFrameStats, sizeof (mFrameStats));
+  mAnimationCount = 0;
+  
+  Status = gBS->CreateEvent (EVT_TIMER, TPL_APPLICATION, NULL, NULL, &mAnimationEvent);
+  if (!EFI_ERROR (Status)) {
+    Status = gBS->SetTimer (mAnimationEvent, TimerPeriodic, DivU64x32 (10000000ULL, UI_ANIMATION_FRAME_RATE));
+    if (EFI_ERROR (Status)) {
+      gBS->CloseEvent (mAnimationEvent);
+      mAnimationEvent = NULL;
+    }
+  }
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Animation timer at %u fps - %r\n", UI_ANIMATION_FRAME_RATE, Status));
+  return Status;
+}
+
+VOID
+FreeAnimation (
+  VOID
+  )
+{
+  UINTN              Index;
+  UINTN              Count;
+  
+  if (mAnimationEvent == NULL) {
+    return;
+  }
+  
+  gBS->SetTimer (mAnimationEvent, TimerCancel, 0);
+  gBS->CloseEvent (mAnimationEvent);
+  mAnimationEvent = NULL;
+  mAnimationCount = 0;
+  
+  if (mFrameStats.FrameCount == 0) {
+    return;
+  }
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Animation frames %u, dropped %u, avg %lu us, max %lu us\n",
+          mFrameStats.FrameCount,
+          mFrameStats.DroppedCount,
+          DivU64x32 (mFrameStats.TotalFrameTime, (UINT32) mFrameStats.FrameCount * 1000),
+          DivU64x32 (mFrameStats.MaxFrameTime, 1000)
+          ));
+  
+  Count = MIN (mFrameStats.FrameCount, UI_FRAME_HISTORY_SIZE);
+  for (Index = mFrameStats.FrameCount - Count; Index < mFrameStats.FrameCount; ++Index) {
+    DEBUG ((DEBUG_INFO, "OCUI: Frame %u - %lu us\n",
+            Index,
+            DivU64x32 (mFrameStats.FrameTime[Index % UI_FRAME_HISTORY_SIZE], 1000)
+            ));
+  }
+}
+
+BOOLEAN
+StartAnimation (
+  IN NDK_UI_ANIMATION_STEP  Step,
+  IN VOID                   *Context
+  )
+{
+  UINTN                     Index;
+  
+  if (mAnimationEvent == NULL || Step == NULL) {
+    return FALSE;
+  }
+  
+  for (Index = 0; Index < mAnimationCount; ++Index) {
+    if (mAnimations[Index].Step == Step) {
+      break;
+    }
+  }
+  
+  if (Index == UI_ANIMATION_MAX) {
+    return FALSE;
+  }
+  
+  if (Index == mAnimationCount) {
+    ++mAnimationCount;
+  }
+  
+  if (mAnimationCount == 1) {
+    mLastFrameTime = 0;
+    mNextFrameTime = 0;
+  }
+  
+  mAnimations[Index].Step = Step;
+  mAnimations[Index].Context = Context;
+  mAnimations[Index].StartTime = GetTimeInNanoSecond (GetPerformanceCounter ());
+  return TRUE;
+}
+
+VOID
+StopAnimation (
+  IN NDK_UI_ANIMATION_STEP  Step,
+  IN BOOLEAN                Finish
+  )
+{
+  UINTN                     Index;
+  
+  for (Index = 0; Index < mAnimationCount; ++Index) {
+    if (mAnimations[Index].Step == Step) {
+      if (Finish) {
+        Step (mAnimations[Index].Context, MAX_UINT64);
+      }
+      mAnimations[Index] = mAnimations[--mAnimationCount];
+      return;
+    }
+  }
+}
+
+BOOLEAN
+IsAnimationActive (
+  IN NDK_UI_ANIMATION_STEP  Step
+  )
+{
+  UINTN                     Index;
+  
+  for (Index = 0; Index < mAnimationCount; ++Index) {
+    if (mAnimations[Index].Step == Step) {
+      return TRUE;
+    }
+  }
+  
+  return FALSE;
+}
+
+VOID
+AnimationTick (
+  VOID
+  )
+{
+  UINT64             StartTime;
+  UINT64             EndTime;
+  UINT64             FrameTime;
+  UINT64             FramePeriod;
+  UINTN              Index;
+  BOOLEAN            NewFrame;
+  
+  if (mAnimationCount == 0 || gBS->CheckEvent (mAnimationEvent) != EFI_SUCCESS) {
+    return;
+  }
+  
+  StartTime = GetTimeInNanoSecond (GetPerformanceCounter ());
+  FramePeriod = DivU64x32 (1000000000ULL, UI_ANIMATION_FRAME_RATE);
+  
+  //
+  // Ticks that fire while a frame is still being drawn are merged by the event,
+  // count them as dropped so slow GOP implementations show up in the statistics.
+  //
+  if (mLastFrameTime != 0 && StartTime - mLastFrameTime > FramePeriod) {
+    mFrameStats.DroppedCount += (UINTN) DivU64x64Remainder (StartTime - mLastFrameTime, FramePeriod, NULL) - 1;
+  }
+  
+  //
+  // A tick skipped for an over budget frame is itself the dropped frame, the next interval
+  // is measured from here so the same time is not counted again.
+  //
+  if (StartTime < mNextFrameTime) {
+    ++mFrameStats.DroppedCount;
+    mLastFrameTime = StartTime;
+    return;
+  }
+  
+  NewFrame = UiBeginFrame ();
+  HidePointer ();
+  for (Index = 0; Index < mAnimationCount;) {
+    if (mAnimations[Index].Step (mAnimations[Index].Context, StartTime - mAnimations[Index].StartTime)) {
+      mAnimations[Index] = mAnimations[--mAnimationCount];
+    } else {
+      ++Index;
+    }
+  }
+  DrawPointer ();
+  if (NewFrame) {
+    UiEndFrame ();
+  }
+  
+  EndTime = GetTimeInNanoSecond (GetPerformanceCounter ());
+  FrameTime = EndTime - StartTime;
+  
+  mFrameStats.FrameTime[mFrameStats.FrameCount % UI_FRAME_HISTORY_SIZE] = FrameTime;
+  mFrameStats.TotalFrameTime += FrameTime;
+  mFrameStats.MaxFrameTime = MAX (mFrameStats.MaxFrameTime, FrameTime);
+  ++mFrameStats.FrameCount;
+  
+  //
+  // A frame over budget leaves at least as much time for input before the next one is drawn.
+  //
+  mLastFrameTime = StartTime;
+  mNextFrameTime = FrameTime > FramePeriod ? EndTime + FrameTime : 0;
+}
@@ -0,0 +1,251 @@
+//
+//  AssetCache.c
+//
+
+#include <NdkBootPicker.h>
+
+STATIC
+NDK_UI_ASSET
+mAssets[UI_ASSET_CACHE_MAX];
+
+STATIC
+UINTN
+mAssetCount = 0;
+
+STATIC
+UINT64
+mAssetClock = 0;
+
+STATIC
+UINTN
+mMemoryBudget = 0;
+
+VOID
+InitMemoryBudget (
+  VOID
+  )
+{
+  EFI_STATUS         Status;
+  UINT32             BudgetMb;
+  UINTN              DataSize;
+  BOOLEAN            IsDefault;
+  
+  DataSize = sizeof (BudgetMb);
+  Status = gRT->GetVariable (
+                             UI_MENU_MEMORY_BUDGET,
+                             &gAppleVendorVariableGuid,
+                             NULL,
+                             &DataSize,
+                             &BudgetMb
+                             );
+  
+  IsDefault = EFI_ERROR (Status) || DataSize != sizeof (BudgetMb) || BudgetMb == 0;
+  if (IsDefault) {
+    BudgetMb = UI_MEMORY_BUDGET_DEFAULT;
+  }
+  
+  mMemoryBudget = (UINTN) BudgetMb * SIZE_1MB;
+  DEBUG ((DEBUG_INFO, "OCUI: Image memory budget %u MB%a\n", BudgetMb, IsDefault ? " (default)" : ""));
+}
+
+UINTN
+GetMemoryBudget (
+  VOID
+  )
+{
+  return mMemoryBudget;
+}
+
+STATIC
+VOID
+EvictAsset (
+  IN UINTN           Index
+  )
+{
+  DEBUG ((DEBUG_INFO, "OCUI: Budget evicts %s, %u KB\n",
+          mAssets[Index].Path,
+          (UINT32) ((UINTN) mAssets[Index].Image->Width * mAssets[Index].Image->Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL) / SIZE_1KB)
+          ));
+  FreeMipChain (&mAssets[Index].Mips);
+  FreeImage (mAssets[Index].Image);
+  mAssets[Index] = mAssets[--mAssetCount];
+}
+
+STATIC
+BOOLEAN
+EvictColdestAsset (
+  VOID
+  )
+{
+  UINTN              Index;
+  UINTN              Coldest;
+  
+  Coldest = mAssetCount;
+  for (Index = 0; Index < mAssetCount; ++Index) {
+    if (mAssets[Index].Refs == 0
+        && (Coldest == mAssetCount || mAssets[Index].LastUse < mAssets[Coldest].LastUse)) {
+      Coldest = Index;
+    }
+  }
+  
+  if (Coldest == mAssetCount) {
+    return FALSE;
+  }
+  
+  EvictAsset (Coldest);
+  return TRUE;
+}
+
+BOOLEAN
+ReserveImageBytes (
+  IN UINTN           Bytes
+  )
+{
+  if (mMemoryBudget == 0) {
+    return TRUE;
+  }
+  
+  //
+  // Decoded assets nobody holds are the first to go, they can be decoded again later.
+  //
+  while (GetImageBytesInUse () + Bytes > mMemoryBudget) {
+    if (!EvictColdestAsset ()) {
+      return FALSE;
+    }
+  }
+  
+  return TRUE;
+}
+
+NDK_UI_IMAGE *
+FindAsset (
+  IN CONST CHAR16    *Path
+  )
+{
+  UINTN              Index;
+  
+  for (Index = 0; Index < mAssetCount; ++Index) {
+    if (StrCmp (mAssets[Index].Path, Path) == 0) {
+      ++mAssets[Index].Refs;
+      mAssets[Index].LastUse = ++mAssetClock;
+      return mAssets[Index].Image;
+    }
+  }
+  
+  return NULL;
+}
+
+VOID
+PrepareAssetMips (
+  IN  NDK_UI_IMAGE      *Image,
+  OUT NDK_UI_MIP_CHAIN  *Mips
+  )
+{
+  UINTN                 MipBytes;
+  
+  //
+  // The smaller levels add a third of the image, without room for them every draw scales the full image.
+  //
+  MipBytes = (UINTN) Image->Width * Image->Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL) / 3;
+  if (ReserveImageBytes (MipBytes)) {
+    AllocateMipChain (Image, Mips);
+  } else {
+    ZeroMem (Mips, sizeof (NDK_UI_MIP_CHAIN));
+    Mips->Levels[0] = Image;
+  }
+}
+
+VOID
+AddAssetChain (
+  IN CONST CHAR16       *Path,
+  IN NDK_UI_MIP_CHAIN   *Mips
+  )
+{
+  if (Mips->Levels[0] == NULL) {
+    return;
+  }
+  
+  if (mAssetCount == UI_ASSET_CACHE_MAX && !EvictColdestAsset ()) {
+    FreeMipChain (Mips);
+    return;
+  }
+  
+  mAssets[mAssetCount].Path = Path;
+  mAssets[mAssetCount].Image = Mips->Levels[0];
+  mAssets[mAssetCount].Mips = *Mips;
+  mAssets[mAssetCount].Refs = 1;
+  mAssets[mAssetCount].LastUse = ++mAssetClock;
+  ++mAssetCount;
+}
+
+VOID
+AddAsset (
+  IN CONST CHAR16    *Path,
+  IN NDK_UI_IMAGE    *Image
+  )
+{
+  NDK_UI_MIP_CHAIN   Mips;
+  
+  if (Image == NULL) {
+    return;
+  }
+  
+  PrepareAssetMips (Image, &Mips);
+  FillMipChain (&Mips);
+  AddAssetChain (Path, &Mips);
+}
+
+VOID
+ReleaseAsset (
+  IN NDK_UI_IMAGE    *Image
+  )
+{
+  UINTN              Index;
+  
+  for (Index = 0; Index < mAssetCount; ++Index) {
+    if (mAssets[Index].Image == Image) {
+      if (mAssets[Index].Refs > 0) {
+        --mAssets[Index].Refs;
+      }
+      return;
+    }
+  }
+  
+  //
+  // Images that never made it into the cache belong to the caller.
+  //
+  FreeImage (Image);
+}
+
+NDK_UI_IMAGE *
+CopyScaledAsset (
+  IN NDK_UI_IMAGE    *Image,
+  IN INTN            Ratio
+  )
+{
+  UINTN              Index;
+  
+  for (Index = 0; Index < mAssetCount; ++Index) {
+    if (mAssets[Index].Image == Image) {
+      return CopyMipImage (&mAssets[Index].Mips, Ratio);
+    }
+  }
+  
+  return CopyScaledImage (Image, Ratio);
+}
+
+VOID
+FreeAssetCache (
+  VOID
+  )
+{
+  UINTN              Index;
+  
+  for (Index = 0; Index < mAssetCount; ++Index) {
+    FreeMipChain (&mAssets[Index].Mips);
+    FreeImage (mAssets[Index].Image);
+  }
+  
+  mAssetCount = 0;
+  mAssetClock = 0;
+}
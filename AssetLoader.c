@@ -0,0 +1,238 @@
+//
+//  AssetLoader.c
+//
+
+#include <NdkBootPicker.h>
+
+STATIC
+NDK_UI_LOAD_JOB *
+mLoadRing[UI_LOAD_QUEUE_SIZE];
+
+STATIC
+volatile UINT32
+mLoadHead = 0;
+
+STATIC
+volatile UINT32
+mLoadTail = 0;
+
+STATIC
+volatile UINT32
+mLoadClosed = 0;
+
+STATIC
+EFI_MP_SERVICES_PROTOCOL *
+mMpServices = NULL;
+
+STATIC
+EFI_EVENT
+mLoadEvent = NULL;
+
+STATIC
+UINTN
+mLoadAps = 0;
+
+STATIC
+BOOLEAN
+mLoadApFlag = TRUE;
+
+STATIC
+UINT32
+mLoadJobs = 0;
+
+STATIC
+volatile UINT32
+mLoadJobsOnAps = 0;
+
+STATIC
+volatile UINT32
+mLoadJobsDone = 0;
+
+STATIC
+NDK_UI_LOAD_JOB *
+PopLoadJob (
+  VOID
+  )
+{
+  UINT32             Tail;
+  NDK_UI_LOAD_JOB    *Job;
+  
+  //
+  // Consumers race for the tail, the slot is read before the claim so a lost race costs nothing.
+  //
+  do {
+    Tail = mLoadTail;
+    if (Tail == mLoadHead) {
+      return NULL;
+    }
+    MemoryFence ();
+    Job = mLoadRing[Tail % UI_LOAD_QUEUE_SIZE];
+  } while (InterlockedCompareExchange32 (&mLoadTail, Tail, Tail + 1) != Tail);
+  
+  return Job;
+}
+
+STATIC
+VOID
+RunLoadJob (
+  IN NDK_UI_LOAD_JOB *Job,
+  IN BOOLEAN         OnAp
+  )
+{
+  SwizzleImage (Job->Mips.Levels[0]);
+  FillMipChain (&Job->Mips);
+  if (OnAp) {
+    InterlockedIncrement (&mLoadJobsOnAps);
+  }
+  InterlockedIncrement (&mLoadJobsDone);
+}
+
+//
+// Runs on every application processor while the loader is open, and on the processor
+// that closes it. Nothing below may allocate memory, print or call boot services.
+//
+STATIC
+VOID
+EFIAPI
+LoadWorker (
+  IN VOID            *Context
+  )
+{
+  NDK_UI_LOAD_JOB    *Job;
+  
+  while (TRUE) {
+    Job = PopLoadJob ();
+    if (Job != NULL) {
+      RunLoadJob (Job, Context != NULL);
+      continue;
+    }
+  
+    if (mLoadClosed != 0 && mLoadTail == mLoadHead) {
+      return;
+    }
+    CpuPause ();
+  }
+}
+
+VOID
+StartAssetLoader (
+  VOID
+  )
+{
+  EFI_STATUS         Status;
+  UINTN              Processors;
+  UINTN              Enabled;
+  
+  mLoadJobs = 0;
+  mLoadJobsOnAps = 0;
+  mLoadJobsDone = 0;
+  mLoadAps = 0;
+  
+  //
+  // The MP services only notice finished APs on their own timer, until then the APs of the
+  // last run still count as busy and this run stays on the BSP.
+  //
+  if (mLoadEvent != NULL) {
+    if (gBS->CheckEvent (mLoadEvent) != EFI_SUCCESS) {
+      DEBUG ((DEBUG_INFO, "OCUI: Asset loader APs still being released, single threaded\n"));
+      return;
+    }
+    gBS->CloseEvent (mLoadEvent);
+    mLoadEvent = NULL;
+  }
+  
+  mLoadHead = 0;
+  mLoadTail = 0;
+  mLoadClosed = 0;
+  
+  Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &mMpServices);
+  if (!EFI_ERROR (Status)) {
+    Status = mMpServices->GetNumberOfProcessors (mMpServices, &Processors, &Enabled);
+  }
+  
+  if (!EFI_ERROR (Status) && Enabled > 1) {
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &mLoadEvent);
+    if (!EFI_ERROR (Status)) {
+      //
+      // Non-blocking start, the workers spin on the queue until it is closed.
+      //
+      Status = mMpServices->StartupAllAPs (mMpServices, LoadWorker, FALSE, mLoadEvent, 0, &mLoadApFlag, NULL);
+      if (EFI_ERROR (Status)) {
+        gBS->CloseEvent (mLoadEvent);
+        mLoadEvent = NULL;
+      } else {
+        mLoadAps = Enabled - 1;
+      }
+    }
+  }
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Asset loader uses %u APs%a\n", (UINT32) mLoadAps, mLoadAps == 0 ? ", single threaded" : ""));
+}
+
+VOID
+QueueLoadJob (
+  IN NDK_UI_LOAD_JOB *Job
+  )
+{
+  NDK_UI_LOAD_JOB    *Pending;
+  
+  ++mLoadJobs;
+  
+  if (mLoadAps == 0) {
+    RunLoadJob (Job, FALSE);
+    return;
+  }
+  
+  //
+  // A full ring means the workers are behind, the producer lends a hand until a slot frees up.
+  //
+  while (mLoadHead - mLoadTail >= UI_LOAD_QUEUE_SIZE) {
+    Pending = PopLoadJob ();
+    if (Pending != NULL) {
+      RunLoadJob (Pending, FALSE);
+    }
+  }
+  
+  mLoadRing[mLoadHead % UI_LOAD_QUEUE_SIZE] = Job;
+  MemoryFence ();
+  ++mLoadHead;
+}
+
+VOID
+StopAssetLoader (
+  VOID
+  )
+{
+  mLoadClosed = 1;
+  MemoryFence ();
+  LoadWorker (NULL);
+  
+  //
+  // The completion event is only signalled from a 100 ms timer in the MP services, far longer
+  // than the jobs take, so the BSP waits on the job count and leaves the event for cleanup.
+  //
+  while (mLoadJobsDone != mLoadJobs) {
+    CpuPause ();
+  }
+  MemoryFence ();
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Asset loader ran %u jobs, %u of them on %u APs\n",
+          mLoadJobs,
+          mLoadJobsOnAps,
+          (UINT32) mLoadAps
+          ));
+}
+
+VOID
+ReleaseAssetLoader (
+  VOID
+  )
+{
+  UINTN              Index;
+  
+  if (mLoadEvent != NULL) {
+    gBS->WaitForEvent (1, &mLoadEvent, &Index);
+    gBS->CloseEvent (mLoadEvent);
+    mLoadEvent = NULL;
+  }
+}
@@ -0,0 +1,235 @@
+//
+//  FrameBuffer.c
+//
+
+#include <NdkBootPicker.h>
+
+STATIC
+UINT8 *
+mFrameBuffer = NULL;
+
+STATIC
+UINTN
+mFrameBufferStride;
+
+STATIC
+UINTN
+mFrameBufferPixelSize;
+
+STATIC
+UINTN
+mFrameBufferWidth;
+
+STATIC
+UINTN
+mFrameBufferHeight;
+
+STATIC
+EFI_GRAPHICS_PIXEL_FORMAT
+mFrameBufferFormat;
+
+STATIC
+UINT8
+mMaskShift[3];
+
+STATIC
+UINT8
+mMaskBits[3];
+
+STATIC
+UINT8 *
+mFrameBufferLine = NULL;
+
+STATIC
+VOID
+GetMaskLayout (
+  IN  UINT32         Mask,
+  OUT UINT8          *Shift,
+  OUT UINT8          *Bits
+  )
+{
+  *Shift = 0;
+  *Bits = 0;
+  
+  if (Mask == 0) {
+    return;
+  }
+  
+  while ((Mask & BIT0) == 0) {
+    Mask >>= 1;
+    ++*Shift;
+  }
+  
+  while ((Mask & BIT0) != 0) {
+    Mask >>= 1;
+    ++*Bits;
+  }
+}
+
+STATIC
+UINT32
+GetMaskValue (
+  IN UINT8           Color,
+  IN UINTN           Channel
+  )
+{
+  UINT32             Value;
+  
+  Value = Color;
+  if (mMaskBits[Channel] < 8) {
+    Value >>= 8 - mMaskBits[Channel];
+  } else {
+    Value <<= mMaskBits[Channel] - 8;
+  }
+  
+  return Value << mMaskShift[Channel];
+}
+
+VOID
+FreeFrameBuffer (
+  VOID
+  )
+{
+  if (mFrameBufferLine != NULL) {
+    FreePool (mFrameBufferLine);
+    mFrameBufferLine = NULL;
+  }
+  
+  mFrameBuffer = NULL;
+}
+
+EFI_STATUS
+InitFrameBuffer (
+  IN EFI_GRAPHICS_OUTPUT_PROTOCOL   *GraphicsOutput
+  )
+{
+  EFI_GRAPHICS_OUTPUT_MODE_INFORMATION  *Info;
+  EFI_PIXEL_BITMASK                     *Masks;
+  
+  FreeFrameBuffer ();
+  
+  if (GraphicsOutput == NULL || GraphicsOutput->Mode->FrameBufferBase == 0) {
+    return EFI_UNSUPPORTED;
+  }
+  
+  Info = GraphicsOutput->Mode->Info;
+  
+  switch (Info->PixelFormat) {
+    case PixelBlueGreenRedReserved8BitPerColor:
+    case PixelRedGreenBlueReserved8BitPerColor:
+      mFrameBufferPixelSize = sizeof (UINT32);
+      break;
+    case PixelBitMask:
+      Masks = &Info->PixelInformation;
+      GetMaskLayout (Masks->RedMask, &mMaskShift[0], &mMaskBits[0]);
+      GetMaskLayout (Masks->GreenMask, &mMaskShift[1], &mMaskBits[1]);
+      GetMaskLayout (Masks->BlueMask, &mMaskShift[2], &mMaskBits[2]);
+      mFrameBufferPixelSize = HighBitSet32 (Masks->RedMask | Masks->GreenMask | Masks->BlueMask | Masks->ReservedMask) < 16
+        ? sizeof (UINT16) : sizeof (UINT32);
+      break;
+    default:
+      return EFI_UNSUPPORTED;
+  }
+  
+  mFrameBufferFormat = Info->PixelFormat;
+  mFrameBufferWidth = Info->HorizontalResolution;
+  mFrameBufferHeight = Info->VerticalResolution;
+  mFrameBufferStride = Info->PixelsPerScanLine * mFrameBufferPixelSize;
+  
+  if (Info->PixelsPerScanLine < mFrameBufferWidth
+      || GraphicsOutput->Mode->FrameBufferSize < mFrameBufferStride * mFrameBufferHeight) {
+    return EFI_UNSUPPORTED;
+  }
+  
+  //
+  // Converted pixels are staged in a line buffer so the frame buffer only sees sequential stores.
+  //
+  if (mFrameBufferFormat != PixelBlueGreenRedReserved8BitPerColor) {
+    mFrameBufferLine = AllocatePool (mFrameBufferWidth * sizeof (UINT32));
+    if (mFrameBufferLine == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+  
+  mFrameBuffer = (UINT8 *) (UINTN) GraphicsOutput->Mode->FrameBufferBase;
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Direct frame buffer %ux%u format %u stride %u\n",
+          mFrameBufferWidth,
+          mFrameBufferHeight,
+          mFrameBufferFormat,
+          mFrameBufferStride
+          ));
+  
+  return EFI_SUCCESS;
+}
+
+BOOLEAN
+IsFrameBufferActive (
+  VOID
+  )
+{
+  return mFrameBuffer != NULL;
+}
+
+BOOLEAN
+FrameBufferBlt (
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Buffer,
+  IN UINTN                          BufferWidth,
+  IN INTN                           AreaXpos,
+  IN INTN                           AreaYpos,
+  IN INTN                           ScreenXpos,
+  IN INTN                           ScreenYpos,
+  IN INTN                           AreaWidth,
+  IN INTN                           AreaHeight
+  )
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL     *Source;
+  UINT8                             *Target;
+  UINT32                            *Line32;
+  UINT16                            *Line16;
+  UINT32                            Value;
+  INTN                              Row;
+  INTN                              Column;
+  
+  if (mFrameBuffer == NULL || Buffer == NULL
+      || ScreenXpos < 0 || ScreenYpos < 0 || AreaWidth <= 0 || AreaHeight <= 0
+      || (UINTN) (ScreenXpos + AreaWidth) > mFrameBufferWidth
+      || (UINTN) (ScreenYpos + AreaHeight) > mFrameBufferHeight) {
+    return FALSE;
+  }
+  
+  Line32 = (UINT32 *) mFrameBufferLine;
+  Line16 = (UINT16 *) mFrameBufferLine;
+  
+  for (Row = 0; Row < AreaHeight; ++Row) {
+    Source = Buffer + (AreaYpos + Row) * BufferWidth + AreaXpos;
+    Target = mFrameBuffer + (ScreenYpos + Row) * mFrameBufferStride + ScreenXpos * mFrameBufferPixelSize;
+    
+    switch (mFrameBufferFormat) {
+      case PixelBlueGreenRedReserved8BitPerColor:
+        CopyMem (Target, Source, AreaWidth * sizeof (UINT32));
+        continue;
+      case PixelRedGreenBlueReserved8BitPerColor:
+        for (Column = 0; Column < AreaWidth; ++Column) {
+          Line32[Column] = Source[Column].Red | (Source[Column].Green << 8) | (Source[Column].Blue << 16);
+        }
+        break;
+      default:
+        for (Column = 0; Column < AreaWidth; ++Column) {
+          Value = GetMaskValue (Source[Column].Red, 0)
+            | GetMaskValue (Source[Column].Green, 1)
+            | GetMaskValue (Source[Column].Blue, 2);
+          if (mFrameBufferPixelSize == sizeof (UINT16)) {
+            Line16[Column] = (UINT16) Value;
+          } else {
+            Line32[Column] = Value;
+          }
+        }
+        break;
+    }
+    
+    CopyMem (Target, mFrameBufferLine, AreaWidth * mFrameBufferPixelSize);
+  }
+  
+  return TRUE;
+}
@@ -0,0 +1,302 @@
+//
+//  GopStats.c
+//
+
+#include <NdkBootPicker.h>
+
+STATIC
+CONST CHAR8 *
+mGopCallerNames[UiGopCallerMax] = {
+  "Other",
+  "Present",
+  "ClearScreen",
+  "DrawMenu",
+  "ScrollMenu",
+  "SwitchIconSelection",
+  "PrintLabel",
+  "PrintDateTime",
+  "PrintTimeOut",
+  "PrintText",
+  "ToolBar",
+  "DrawPointer",
+  "Hud"
+};
+
+STATIC
+NDK_UI_GOP_CALLER
+mGopCaller = UiGopOther;
+
+STATIC
+NDK_UI_GOP_COUNTERS
+mGopCallers[UiGopCallerMax];
+
+STATIC
+NDK_UI_GOP_COUNTERS
+mGopFrame;
+
+STATIC
+NDK_UI_GOP_COUNTERS
+mGopLastFrame;
+
+STATIC
+NDK_UI_GOP_COUNTERS
+mGopPeakFrame;
+
+STATIC
+UINT64
+mGopFrames;
+
+STATIC
+UINT64
+mGopFrameStart = 0;
+
+STATIC
+UINT64
+mGopLastBlt = 0;
+
+STATIC
+UINT64
+mGopFrameHistory[UI_GOP_FRAME_AVERAGE];
+
+VOID
+ResetGopStats (
+  VOID
+  )
+{
+  mGopCaller = UiGopOther;
+  ZeroMem (mGopCallers, sizeof (mGopCallers));
+  ZeroMem (&mGopFrame, sizeof (mGopFrame));
+  ZeroMem (&mGopLastFrame, sizeof (mGopLastFrame));
+  ZeroMem (&mGopPeakFrame, sizeof (mGopPeakFrame));
+  ZeroMem (mGopFrameHistory, sizeof (mGopFrameHistory));
+  mGopFrames = 0;
+  mGopFrameStart = 0;
+}
+
+NDK_UI_GOP_CALLER
+GopEnterCaller (
+  IN NDK_UI_GOP_CALLER  Caller
+  )
+{
+  NDK_UI_GOP_CALLER     Previous;
+  
+  Previous = mGopCaller;
+  //
+  // Everything drawn on behalf of the HUD stays booked to it, including the flush it triggers.
+  //
+  if (mGopCaller != UiGopHud) {
+    mGopCaller = Caller;
+  }
+  
+  return Previous;
+}
+
+VOID
+GopLeaveCaller (
+  IN NDK_UI_GOP_CALLER  Previous
+  )
+{
+  mGopCaller = Previous;
+}
+
+VOID
+GopCountDraw (
+  IN UINTN             Pixels
+  )
+{
+  ++mGopCallers[mGopCaller].Calls;
+  mGopCallers[mGopCaller].PixelsDrawn += Pixels;
+  //
+  // The HUD reports frame numbers, so its own drawing stays out of them.
+  //
+  if (mGopCaller == UiGopHud) {
+    return;
+  }
+  ++mGopFrame.Calls;
+  mGopFrame.PixelsDrawn += Pixels;
+}
+
+VOID
+GopCountTake (
+  IN UINTN             Pixels
+  )
+{
+  ++mGopCallers[mGopCaller].Calls;
+  mGopCallers[mGopCaller].PixelsTaken += Pixels;
+  if (mGopCaller == UiGopHud) {
+    return;
+  }
+  ++mGopFrame.Calls;
+  mGopFrame.PixelsTaken += Pixels;
+}
+
+UINT64
+GopBltBegin (
+  VOID
+  )
+{
+  return GetPerformanceCounter ();
+}
+
+VOID
+GopBltEnd (
+  IN UINT64            Start,
+  IN UINTN             PixelsToVideo,
+  IN UINTN             PixelsFromVideo
+  )
+{
+  UINT64               Ticks;
+  UINT64               End;
+  
+  End = GetPerformanceCounter ();
+  Ticks = End - Start;
+  
+  ++mGopCallers[mGopCaller].BltCalls;
+  mGopCallers[mGopCaller].PixelsToVideo += PixelsToVideo;
+  mGopCallers[mGopCaller].PixelsFromVideo += PixelsFromVideo;
+  mGopCallers[mGopCaller].BltTicks += Ticks;
+  
+  if (mGopCaller == UiGopHud) {
+    return;
+  }
+  mGopLastBlt = End;
+  ++mGopFrame.BltCalls;
+  mGopFrame.PixelsToVideo += PixelsToVideo;
+  mGopFrame.PixelsFromVideo += PixelsFromVideo;
+  mGopFrame.BltTicks += Ticks;
+}
+
+VOID
+GopBeginFrame (
+  VOID
+  )
+{
+  mGopFrameStart = GetPerformanceCounter ();
+}
+
+VOID
+GopEndFrame (
+  VOID
+  )
+{
+  if (mGopFrame.Calls == 0 && mGopFrame.BltCalls == 0) {
+    return;
+  }
+  
+  if (mGopFrameStart != 0) {
+    mGopFrame.FrameTicks = GetPerformanceCounter () - mGopFrameStart;
+    mGopFrameStart = 0;
+  }
+  mGopFrameHistory[mGopFrames % UI_GOP_FRAME_AVERAGE] = mGopFrame.FrameTicks;
+  ++mGopFrames;
+  CopyMem (&mGopLastFrame, &mGopFrame, sizeof (mGopFrame));
+  if (mGopFrame.BltTicks > mGopPeakFrame.BltTicks) {
+    CopyMem (&mGopPeakFrame, &mGopFrame, sizeof (mGopFrame));
+  }
+  ZeroMem (&mGopFrame, sizeof (mGopFrame));
+}
+
+NDK_UI_GOP_COUNTERS *
+GetGopLastFrame (
+  VOID
+  )
+{
+  return &mGopLastFrame;
+}
+
+UINT64
+GetGopLastBltTicks (
+  VOID
+  )
+{
+  return mGopLastBlt;
+}
+
+UINT64
+GetGopAverageFrameTicks (
+  VOID
+  )
+{
+  UINT64               Total;
+  UINTN                Count;
+  UINTN                Index;
+  
+  Count = (UINTN) MIN (mGopFrames, UI_GOP_FRAME_AVERAGE);
+  if (Count == 0) {
+    return 0;
+  }
+  
+  Total = 0;
+  for (Index = 0; Index < Count; ++Index) {
+    Total += mGopFrameHistory[Index];
+  }
+  
+  return DivU64x32 (Total, (UINT32) Count);
+}
+
+STATIC
+UINTN
+AppendGopCounters (
+  IN OUT CHAR8                *Buffer,
+  IN     UINTN                BufferSize,
+  IN     CONST CHAR8          *Name,
+  IN     NDK_UI_GOP_COUNTERS  *Counters
+  )
+{
+  UINTN                       Length;
+  
+  Length = AsciiSPrint (Buffer,
+                        BufferSize,
+                        "%a,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+                        Name,
+                        Counters->Calls,
+                        Counters->PixelsDrawn,
+                        Counters->PixelsTaken,
+                        Counters->BltCalls,
+                        Counters->PixelsToVideo,
+                        Counters->PixelsFromVideo,
+                        DivU64x32 (GetTimeInNanoSecond (Counters->BltTicks), 1000)
+                        );
+  
+  DEBUG ((DEBUG_INFO, "OCUI: GOP %a", Buffer));
+  
+  return Length;
+}
+
+CHAR8 *
+GopStatsReport (
+  OUT UINTN            *ReportSize
+  )
+{
+  CHAR8                *Report;
+  UINTN                BufferSize;
+  UINTN                Length;
+  UINTN                Index;
+  
+  *ReportSize = 0;
+  BufferSize = (UiGopCallerMax + 4) * UI_GOP_REPORT_LINE;
+  Report = AllocateZeroPool (BufferSize);
+  if (Report == NULL) {
+    return NULL;
+  }
+  
+  Length = AsciiSPrint (Report,
+                        BufferSize,
+                        "Frames,%lu\nCaller,Calls,PixelsDrawn,PixelsTaken,BltCalls,PixelsToVideo,PixelsFromVideo,BltMicroSeconds\n",
+                        mGopFrames
+                        );
+  
+  for (Index = 0; Index < UiGopCallerMax; ++Index) {
+    if (mGopCallers[Index].Calls == 0 && mGopCallers[Index].BltCalls == 0) {
+      continue;
+    }
+    Length += AppendGopCounters (Report + Length, BufferSize - Length, mGopCallerNames[Index], &mGopCallers[Index]);
+  }
+  
+  Length += AppendGopCounters (Report + Length, BufferSize - Length, "LastFrame", &mGopLastFrame);
+  Length += AppendGopCounters (Report + Length, BufferSize - Length, "PeakFrame", &mGopPeakFrame);
+  
+  *ReportSize = Length;
+  
+  return Report;
+}
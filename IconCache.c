@@ -0,0 +1,295 @@
+//
+//  IconCache.c
+//
+
+#include <NdkBootPicker.h>
+
+STATIC
+NDK_UI_ICON_CACHE_ENTRY
+mCacheEntries[UI_ICON_CACHE_MAX];
+
+STATIC
+NDK_UI_IMAGE *
+mCacheImages[UI_ICON_CACHE_MAX];
+
+STATIC
+UINTN
+mCacheCount = 0;
+
+STATIC
+UINT32
+mCacheScale = 0;
+
+STATIC
+UINT32
+mCacheScreenHeight = 0;
+
+STATIC
+BOOLEAN
+mCacheDirty = FALSE;
+
+STATIC
+BOOLEAN
+IsIconCacheValid (
+  IN NDK_UI_ICON_CACHE_HEADER  *Header,
+  IN UINTN                     BufferSize
+  )
+{
+  UINTN                        Index;
+  UINTN                        Pixels;
+  NDK_UI_ICON_CACHE_ENTRY      *Entries;
+  
+  if (BufferSize < sizeof (*Header)
+      || Header->Signature != UI_ICON_CACHE_SIGNATURE
+      || Header->Version != UI_ICON_CACHE_VERSION
+      || Header->UiScale != mCacheScale
+      || Header->ScreenHeight != mCacheScreenHeight
+      || Header->EntryCount > UI_ICON_CACHE_MAX) {
+    return FALSE;
+  }
+  
+  Pixels = (UINTN) Header->Width * Header->Height;
+  if (BufferSize != sizeof (*Header) + Header->EntryCount * sizeof (*Entries) + Pixels * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)) {
+    return FALSE;
+  }
+  
+  //
+  // Every sub-rectangle has to lie inside the atlas, a torn write must never be read past its end.
+  //
+  Entries = (NDK_UI_ICON_CACHE_ENTRY *) (Header + 1);
+  for (Index = 0; Index < Header->EntryCount; ++Index) {
+    if (Entries[Index].Width == 0 || Entries[Index].Width > Header->Width
+        || Entries[Index].Height == 0 || (UINTN) Entries[Index].Ypos + Entries[Index].Height > Header->Height
+        || Entries[Index].Path[UI_ICON_CACHE_PATH_MAX - 1] != L'\0') {
+      return FALSE;
+    }
+  }
+  
+  return TRUE;
+}
+
+VOID
+InitIconCache (
+  IN VOID            *Buffer OPTIONAL,
+  IN UINTN           BufferSize,
+  IN UINT32          UiScale,
+  IN UINT32          ScreenHeight
+  )
+{
+  NDK_UI_ICON_CACHE_HEADER  *Header;
+  NDK_UI_ICON_CACHE_ENTRY   *Entries;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pixels;
+  NDK_UI_IMAGE              *Image;
+  UINTN                     Index;
+  
+  FreeIconCache ();
+  mCacheScale = UiScale;
+  mCacheScreenHeight = ScreenHeight;
+  
+  if (Buffer == NULL) {
+    return;
+  }
+  
+  Header = (NDK_UI_ICON_CACHE_HEADER *) Buffer;
+  if (!IsIconCacheValid (Header, BufferSize)) {
+    DEBUG ((DEBUG_INFO, "OCUI: Icon cache for scale %u is stale, rebuilding\n", UiScale));
+    FreePool (Buffer);
+    mCacheDirty = TRUE;
+    return;
+  }
+  
+  Entries = (NDK_UI_ICON_CACHE_ENTRY *) (Header + 1);
+  Pixels = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (Entries + Header->EntryCount);
+  for (Index = 0; Index < Header->EntryCount; ++Index) {
+    Image = CreateImage (Entries[Index].Width, Entries[Index].Height, TRUE);
+    if (Image == NULL) {
+      break;
+    }
+    RawCopy (Image->Bitmap,
+             Pixels + (UINTN) Entries[Index].Ypos * Header->Width,
+             Image->Width,
+             Image->Height,
+             Image->Width,
+             Header->Width
+             );
+    mCacheEntries[mCacheCount] = Entries[Index];
+    mCacheImages[mCacheCount] = Image;
+    ++mCacheCount;
+  }
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Icon cache for scale %u has %u icons\n", UiScale, (UINT32) mCacheCount));
+  FreePool (Buffer);
+}
+
+NDK_UI_ICON_CACHE_ENTRY *
+FindCachedIcon (
+  IN CONST CHAR16     *Path,
+  IN NDK_UI_FILE_STAMP *Stamp
+  )
+{
+  UINTN               Index;
+  
+  for (Index = 0; Index < mCacheCount; ++Index) {
+    if (StrCmp (mCacheEntries[Index].Path, Path) == 0) {
+      if (CompareMem (&mCacheEntries[Index].Stamp, Stamp, sizeof (*Stamp)) != 0) {
+        return NULL;
+      }
+      return &mCacheEntries[Index];
+    }
+  }
+  
+  return NULL;
+}
+
+NDK_UI_IMAGE *
+CopyCachedIcon (
+  IN NDK_UI_ICON_CACHE_ENTRY *Entry,
+  IN INTN                    Ratio
+  )
+{
+  if (Entry == NULL || Entry->Ratio != Ratio) {
+    return NULL;
+  }
+  
+  return CopyImage (mCacheImages[Entry - mCacheEntries]);
+}
+
+VOID
+StoreCachedIcon (
+  IN CONST CHAR16     *Path,
+  IN NDK_UI_FILE_STAMP *Stamp,
+  IN UINT16           SourceWidth,
+  IN INTN             Ratio,
+  IN NDK_UI_IMAGE     *Image
+  )
+{
+  UINTN               Index;
+  NDK_UI_IMAGE        *NewImage;
+  
+  if (Image == NULL || mCacheScale == 0 || StrLen (Path) >= UI_ICON_CACHE_PATH_MAX) {
+    return;
+  }
+  
+  //
+  // A stale entry for the same file is replaced in place.
+  //
+  for (Index = 0; Index < mCacheCount; ++Index) {
+    if (StrCmp (mCacheEntries[Index].Path, Path) == 0) {
+      break;
+    }
+  }
+  
+  if (Index == UI_ICON_CACHE_MAX) {
+    return;
+  }
+  
+  NewImage = CopyImage (Image);
+  if (NewImage == NULL) {
+    return;
+  }
+  
+  if (Index == mCacheCount) {
+    ++mCacheCount;
+  } else {
+    FreeImage (mCacheImages[Index]);
+  }
+  
+  ZeroMem (&mCacheEntries[Index], sizeof (NDK_UI_ICON_CACHE_ENTRY));
+  StrCpyS (mCacheEntries[Index].Path, UI_ICON_CACHE_PATH_MAX, Path);
+  mCacheEntries[Index].Stamp = *Stamp;
+  mCacheEntries[Index].SourceWidth = SourceWidth;
+  mCacheEntries[Index].Ratio = (UINT16) Ratio;
+  mCacheEntries[Index].Width = NewImage->Width;
+  mCacheEntries[Index].Height = NewImage->Height;
+  mCacheImages[Index] = NewImage;
+  mCacheDirty = TRUE;
+}
+
+VOID *
+IconCacheData (
+  OUT UINTN           *DataSize
+  )
+{
+  NDK_UI_ICON_CACHE_HEADER  *Header;
+  NDK_UI_ICON_CACHE_ENTRY   *Entries;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pixels;
+  UINTN                     Index;
+  UINTN                     Width;
+  UINTN                     Height;
+  
+  *DataSize = 0;
+  if (!mCacheDirty || mCacheCount == 0) {
+    return NULL;
+  }
+  
+  //
+  // Icons are stacked in one strip as wide as the widest of them.
+  //
+  Width = 0;
+  Height = 0;
+  for (Index = 0; Index < mCacheCount; ++Index) {
+    mCacheEntries[Index].Ypos = (UINT16) Height;
+    Width = MAX (Width, mCacheImages[Index]->Width);
+    Height += mCacheImages[Index]->Height;
+  }
+  
+  if (Height > MAX_UINT16) {
+    return NULL;
+  }
+  
+  *DataSize = sizeof (*Header) + mCacheCount * sizeof (*Entries) + Width * Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  Header = AllocateZeroPool (*DataSize);
+  if (Header == NULL) {
+    *DataSize = 0;
+    return NULL;
+  }
+  
+  Header->Signature = UI_ICON_CACHE_SIGNATURE;
+  Header->Version = UI_ICON_CACHE_VERSION;
+  Header->UiScale = mCacheScale;
+  Header->ScreenHeight = mCacheScreenHeight;
+  Header->EntryCount = (UINT32) mCacheCount;
+  Header->Width = (UINT16) Width;
+  Header->Height = (UINT16) Height;
+  
+  Entries = (NDK_UI_ICON_CACHE_ENTRY *) (Header + 1);
+  Pixels = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (Entries + mCacheCount);
+  CopyMem (Entries, mCacheEntries, mCacheCount * sizeof (*Entries));
+  for (Index = 0; Index < mCacheCount; ++Index) {
+    RawCopy (Pixels + (UINTN) Entries[Index].Ypos * Width,
+             mCacheImages[Index]->Bitmap,
+             mCacheImages[Index]->Width,
+             mCacheImages[Index]->Height,
+             Width,
+             mCacheImages[Index]->Width
+             );
+  }
+  
+  mCacheDirty = FALSE;
+  return Header;
+}
+
+UINT32
+GetIconCacheScale (
+  VOID
+  )
+{
+  return mCacheScale;
+}
+
+VOID
+FreeIconCache (
+  VOID
+  )
+{
+  UINTN               Index;
+  
+  for (Index = 0; Index < mCacheCount; ++Index) {
+    FreeImage (mCacheImages[Index]);
+    mCacheImages[Index] = NULL;
+  }
+  
+  mCacheCount = 0;
+  mCacheScale = 0;
+  mCacheDirty = FALSE;
+}
@@ -0,0 +1,242 @@
+//
+//  ImageSlab.c
+//
+
+#include <NdkBootPicker.h>
+
+STATIC
+NDK_UI_SLAB_CLASS
+mSlabClasses[UI_SLAB_CLASS_MAX];
+
+STATIC
+UINTN
+mSlabClassCount = 0;
+
+STATIC
+UINT64
+mSlabRequests = 0;
+
+STATIC
+VOID
+ReportImageSlabs (
+  VOID
+  )
+{
+  UINTN              Index;
+  UINT64             Served;
+  UINT64             Chunks;
+  NDK_UI_SLAB_CLASS  *Class;
+  
+  if (mSlabRequests == 0) {
+    return;
+  }
+  
+  Served = 0;
+  Chunks = 0;
+  for (Index = 0; Index < mSlabClassCount; ++Index) {
+    Class = &mSlabClasses[Index];
+    DEBUG ((DEBUG_INFO, "OCUI: Slab %u px - served %lu, reused %lu, peak %u live, %u chunks\n",
+            (UINT32) Class->Pixels,
+            Class->Served,
+            Class->Served - MIN (Class->Served, (UINT64) Class->ChunkCount * Class->ObjectsPerChunk),
+            (UINT32) Class->PeakLive,
+            (UINT32) Class->ChunkCount
+            ));
+    Served += Class->Served;
+    Chunks += Class->ChunkCount;
+  }
+  
+  //
+  // Every bitmap served from a slab is a pool allocation and free that did not happen,
+  // only the chunks themselves went to the firmware.
+  //
+  DEBUG ((DEBUG_INFO, "OCUI: Slabs served %lu of %lu bitmaps (%lu%%), %lu pool allocations avoided\n",
+          Served,
+          mSlabRequests,
+          DivU64x64Remainder (MultU64x32 (Served, 100), mSlabRequests, NULL),
+          Served - MIN (Served, Chunks)
+          ));
+}
+
+VOID
+FreeImageSlabs (
+  VOID
+  )
+{
+  UINTN              Index;
+  UINTN              Chunk;
+  UINTN              Live;
+  NDK_UI_SLAB_CLASS  *Class;
+  
+  ReportImageSlabs ();
+  
+  Live = 0;
+  for (Index = 0; Index < mSlabClassCount; ++Index) {
+    Live += mSlabClasses[Index].Live;
+  }
+  
+  //
+  // Bitmaps still in use keep their chunks, FreeImage must be able to find them later.
+  //
+  if (Live != 0) {
+    DEBUG ((DEBUG_INFO, "OCUI: Slabs kept, %u bitmaps still in use\n", (UINT32) Live));
+    return;
+  }
+  
+  for (Index = 0; Index < mSlabClassCount; ++Index) {
+    Class = &mSlabClasses[Index];
+    for (Chunk = 0; Chunk < Class->ChunkCount; ++Chunk) {
+      FreePages (Class->Chunks[Chunk], Class->ChunkPages);
+    }
+  }
+  
+  ZeroMem (mSlabClasses, sizeof (mSlabClasses));
+  mSlabClassCount = 0;
+  mSlabRequests = 0;
+}
+
+VOID
+ConfigureImageSlabs (
+  IN CONST UINTN     *Pixels,
+  IN UINTN           Count
+  )
+{
+  UINTN              Index;
+  UINTN              Slot;
+  NDK_UI_SLAB_CLASS  *Class;
+  
+  FreeImageSlabs ();
+  if (mSlabClassCount != 0) {
+    return;
+  }
+  
+  //
+  // Classes are kept sorted so the first one that fits is also the tightest.
+  //
+  for (Index = 0; Index < Count && mSlabClassCount < UI_SLAB_CLASS_MAX; ++Index) {
+    if (Pixels[Index] == 0) {
+      continue;
+    }
+  
+    Slot = 0;
+    while (Slot < mSlabClassCount && mSlabClasses[Slot].Pixels < Pixels[Index]) {
+      ++Slot;
+    }
+    if (Slot < mSlabClassCount && mSlabClasses[Slot].Pixels == Pixels[Index]) {
+      continue;
+    }
+  
+    CopyMem (&mSlabClasses[Slot + 1], &mSlabClasses[Slot], (mSlabClassCount - Slot) * sizeof (NDK_UI_SLAB_CLASS));
+    ++mSlabClassCount;
+  
+    Class = &mSlabClasses[Slot];
+    ZeroMem (Class, sizeof (*Class));
+    Class->Pixels = Pixels[Index];
+    Class->ObjectSize = ALIGN_VALUE (Pixels[Index] * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL), UI_SLAB_ALIGNMENT);
+    Class->ObjectsPerChunk = MAX (UI_SLAB_CHUNK_SIZE / Class->ObjectSize, 2);
+    Class->ChunkPages = EFI_SIZE_TO_PAGES (Class->ObjectsPerChunk * Class->ObjectSize);
+    Class->ObjectsPerChunk = EFI_PAGES_TO_SIZE (Class->ChunkPages) / Class->ObjectSize;
+  }
+  
+  for (Index = 0; Index < mSlabClassCount; ++Index) {
+    DEBUG ((DEBUG_INFO, "OCUI: Slab class %u px, %u per chunk\n",
+            (UINT32) mSlabClasses[Index].Pixels,
+            (UINT32) mSlabClasses[Index].ObjectsPerChunk
+            ));
+  }
+}
+
+STATIC
+BOOLEAN
+RefillSlabClass (
+  IN NDK_UI_SLAB_CLASS  *Class
+  )
+{
+  UINT8                 *Chunk;
+  UINTN                 Index;
+  
+  if (Class->ChunkCount == UI_SLAB_CHUNK_MAX) {
+    return FALSE;
+  }
+  
+  //
+  // Pages are 4 KB aligned, objects are multiples of the alignment, so every bitmap starts on a cache line.
+  //
+  Chunk = AllocatePages (Class->ChunkPages);
+  if (Chunk == NULL) {
+    return FALSE;
+  }
+  
+  Class->Chunks[Class->ChunkCount++] = Chunk;
+  for (Index = Class->ObjectsPerChunk; Index > 0; --Index) {
+    *(VOID **) (Chunk + (Index - 1) * Class->ObjectSize) = Class->FreeList;
+    Class->FreeList = Chunk + (Index - 1) * Class->ObjectSize;
+  }
+  
+  return TRUE;
+}
+
+EFI_GRAPHICS_OUTPUT_BLT_PIXEL *
+AllocateSlabBitmap (
+  IN UINTN           Pixels
+  )
+{
+  UINTN              Index;
+  VOID               *Bitmap;
+  NDK_UI_SLAB_CLASS  *Class;
+  
+  ++mSlabRequests;
+  
+  //
+  // A class serves sizes down to half of its own, smaller ones would waste more than they save.
+  //
+  for (Index = 0; Index < mSlabClassCount; ++Index) {
+    if (mSlabClasses[Index].Pixels >= Pixels) {
+      break;
+    }
+  }
+  
+  if (Index == mSlabClassCount || Pixels * 2 < mSlabClasses[Index].Pixels) {
+    return NULL;
+  }
+  
+  Class = &mSlabClasses[Index];
+  if (Class->FreeList == NULL && !RefillSlabClass (Class)) {
+    return NULL;
+  }
+  
+  Bitmap = Class->FreeList;
+  Class->FreeList = *(VOID **) Bitmap;
+  ++Class->Served;
+  ++Class->Live;
+  Class->PeakLive = MAX (Class->PeakLive, Class->Live);
+  
+  ZeroMem (Bitmap, Pixels * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  return Bitmap;
+}
+
+BOOLEAN
+FreeSlabBitmap (
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Bitmap
+  )
+{
+  UINTN              Index;
+  UINTN              Chunk;
+  UINT8              *Base;
+  NDK_UI_SLAB_CLASS  *Class;
+  
+  for (Index = 0; Index < mSlabClassCount; ++Index) {
+    Class = &mSlabClasses[Index];
+    for (Chunk = 0; Chunk < Class->ChunkCount; ++Chunk) {
+      Base = Class->Chunks[Chunk];
+      if ((UINT8 *) Bitmap >= Base && (UINT8 *) Bitmap < Base + EFI_PAGES_TO_SIZE (Class->ChunkPages)) {
+        *(VOID **) Bitmap = Class->FreeList;
+        Class->FreeList = Bitmap;
+        --Class->Live;
+        return TRUE;
+      }
+    }
+  }
+  
+  return FALSE;
+}
@@ -7,6 +7,24 @@
 
 #include <NdkBootPicker.h>
 
+//
+// Images created here are booked to this file by the pool tracker in debug builds,
+// TrackCreateImage moves them to the caller.
+//
+#undef CreateImage
+
+STATIC
+UINTN
+mImageBytes = 0;
+
+UINTN
+GetImageBytesInUse (
+  VOID
+  )
+{
+  return mImageBytes;
+}
+
 VOID
 FreeImage (
   IN NDK_UI_IMAGE    *Image
@@ -14,13 +32,129 @@ FreeImage (
 {
   if (Image != NULL) {
     if (Image->Bitmap != NULL) {
-      FreePool (Image->Bitmap);
+      mImageBytes -= (UINTN) Image->Width * Image->Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+      if (!FreeSlabBitmap (Image->Bitmap)) {
+        FreePool (Image->Bitmap);
+      }
       Image->Bitmap = NULL;
     }
     FreePool (Image);
   }
 }
 
+NDK_UI_ATLAS *
+CreateAtlas (
+  IN UINT16          SlotWidth,
+  IN UINT16          SlotHeight,
+  IN UINTN           SlotCount
+  )
+{
+  NDK_UI_ATLAS       *Atlas;
+  UINTN              Size;
+  
+  if (SlotWidth == 0 || SlotHeight == 0 || SlotCount == 0 || SlotCount > OC_INPUT_MAX) {
+    return NULL;
+  }
+  
+  Atlas = AllocateZeroPool (sizeof (NDK_UI_ATLAS));
+  if (Atlas == NULL) {
+    return NULL;
+  }
+  
+  Atlas->SlotWidth = SlotWidth;
+  Atlas->SlotHeight = SlotHeight;
+  Atlas->SlotCount = SlotCount;
+  
+  //
+  // Atlas width is rounded up to 16 pixels so every slot row starts on a cache line.
+  //
+  Atlas->Image.Width = (UINT16) ALIGN_VALUE (SlotWidth, 16);
+  Atlas->Image.Height = (UINT16) (SlotHeight * SlotCount);
+  Atlas->Image.IsAlpha = TRUE;
+  
+  Size = (UINTN) Atlas->Image.Width * Atlas->Image.Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  Atlas->Pages = EFI_SIZE_TO_PAGES (Size);
+  Atlas->Image.Bitmap = AllocatePages (Atlas->Pages);
+  if (Atlas->Image.Bitmap == NULL) {
+    FreePool (Atlas);
+    return NULL;
+  }
+  
+  ZeroMem (Atlas->Image.Bitmap, Size);
+  mImageBytes += EFI_PAGES_TO_SIZE (Atlas->Pages);
+  
+  return Atlas;
+}
+
+VOID
+FreeAtlas (
+  IN NDK_UI_ATLAS    *Atlas
+  )
+{
+  if (Atlas != NULL) {
+    if (Atlas->Image.Bitmap != NULL) {
+      mImageBytes -= EFI_PAGES_TO_SIZE (Atlas->Pages);
+      FreePages (Atlas->Image.Bitmap, Atlas->Pages);
+    }
+    FreePool (Atlas);
+  }
+}
+
+BOOLEAN
+AtlasAddImage (
+  IN OUT NDK_UI_ATLAS    *Atlas,
+  IN     NDK_UI_IMAGE    *Image,
+     OUT AREA_RECT       *Rect
+  )
+{
+  UINTN                  Slot;
+  
+  if (Atlas == NULL || Image == NULL || Rect == NULL) {
+    return FALSE;
+  }
+  
+  for (Slot = 0; Slot < Atlas->SlotCount; ++Slot) {
+    if (!Atlas->SlotUsed[Slot]) {
+      break;
+    }
+  }
+  
+  if (Slot == Atlas->SlotCount) {
+    DEBUG ((DEBUG_INFO, "OCUI: Atlas is full\n"));
+    return FALSE;
+  }
+  
+  Atlas->SlotUsed[Slot] = TRUE;
+  Rect->Xpos = 0;
+  Rect->Ypos = Slot * Atlas->SlotHeight;
+  Rect->Width = MIN (Image->Width, Atlas->SlotWidth);
+  Rect->Height = MIN (Image->Height, Atlas->SlotHeight);
+  
+  RawCopy (Atlas->Image.Bitmap + Rect->Ypos * Atlas->Image.Width,
+           Image->Bitmap,
+           Rect->Width,
+           Rect->Height,
+           Atlas->Image.Width,
+           Image->Width
+           );
+  
+  return TRUE;
+}
+
+VOID
+AtlasRemoveImage (
+  IN OUT NDK_UI_ATLAS    *Atlas,
+  IN OUT AREA_RECT       *Rect
+  )
+{
+  if (Atlas == NULL || Rect == NULL || Rect->Width == 0) {
+    return;
+  }
+  
+  Atlas->SlotUsed[Rect->Ypos / Atlas->SlotHeight] = FALSE;
+  ZeroMem (Rect, sizeof (AREA_RECT));
+}
+
 NDK_UI_IMAGE *
 CreateImage (
   IN UINT16       Width,
@@ -41,7 +175,10 @@ CreateImage (
     return NULL;
   }
   
-  NewImage->Bitmap = AllocateZeroPool (Width * Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  NewImage->Bitmap = AllocateSlabBitmap ((UINTN) Width * Height);
+  if (NewImage->Bitmap == NULL) {
+    NewImage->Bitmap = AllocateZeroPool (Width * Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  }
   if (NewImage->Bitmap == NULL) {
     FreePool (NewImage);
     return NULL;
@@ -50,6 +187,7 @@ CreateImage (
   NewImage->Width = Width;
   NewImage->Height = Height;
   NewImage->IsAlpha = IsAlpha;
+  mImageBytes += (UINTN) Width * Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
   
   return NewImage;
 }
@@ -81,56 +219,224 @@ RestrictImageArea (
   }
 }
 
+//
+// Every compose variant is the same loop. The flags are literal constants in each instance,
+// so the compiler drops the stages a variant does not use and the pixel loop never checks the mode.
+//
+#define UI_COMPOSE_KERNEL(WithSrcAlpha, WithDstAlpha, WithOpacity, WithColor, WithPremul) \
+STATIC \
+VOID \
+RawComposeKernel##WithSrcAlpha##WithDstAlpha##WithOpacity##WithColor##WithPremul ( \
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *CompBasePtr, \
+  IN     EFI_GRAPHICS_OUTPUT_BLT_PIXEL *TopBasePtr, \
+  IN     INTN                          Width, \
+  IN     INTN                          Height, \
+  IN     INTN                          CompLineOffset, \
+  IN     INTN                          TopLineOffset, \
+  IN     CONST NDK_UI_BLEND            *Blend \
+  ) \
+{ \
+  INTN                                 X; \
+  INTN                                 Y; \
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *TopPtr; \
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *CompPtr; \
+  INTN                                 Opacity; \
+  INTN                                 ColorDiff; \
+  INTN                                 Ceiling; \
+  INTN                                 Alpha; \
+  INTN                                 Weight; \
+  INTN                                 TempAlpha; \
+  INTN                                 Total; \
+  INTN                                 Blue; \
+  INTN                                 Green; \
+  INTN                                 Red; \
+  \
+  Opacity = Blend->Opacity; \
+  ColorDiff = Blend->ColorDiff; \
+  for (Y = 0; Y < Height; ++Y) { \
+    TopPtr = TopBasePtr; \
+    CompPtr = CompBasePtr; \
+    for (X = 0; X < Width; ++X, ++TopPtr, ++CompPtr) { \
+      Alpha = WithSrcAlpha ? TopPtr->Reserved : 255; \
+      if (WithOpacity) { \
+        Alpha = Alpha * Opacity / 255; \
+      } \
+      if (Alpha == 0) { \
+        if (!WithDstAlpha) { \
+          CompPtr->Reserved = 255; \
+        } \
+        continue; \
+      } \
+  \
+      Blue = TopPtr->Blue; \
+      Green = TopPtr->Green; \
+      Red = TopPtr->Red; \
+      if (WithColor) { \
+        Ceiling = (WithPremul && WithSrcAlpha) ? TopPtr->Reserved : 255; \
+        Blue = MIN (Blue + Blue * ColorDiff / 255, Ceiling); \
+        Green = MIN (Green + Green * ColorDiff / 255, Ceiling); \
+        Red = MIN (Red + Red * ColorDiff / 255, Ceiling); \
+      } \
+      if (WithPremul && WithOpacity) { \
+        Blue = Blue * Opacity / 255; \
+        Green = Green * Opacity / 255; \
+        Red = Red * Opacity / 255; \
+      } \
+  \
+      if (Alpha == 255) { \
+        CompPtr->Blue = (UINT8) Blue; \
+        CompPtr->Green = (UINT8) Green; \
+        CompPtr->Red = (UINT8) Red; \
+        CompPtr->Reserved = (WithSrcAlpha || WithOpacity) ? 255 : TopPtr->Reserved; \
+      } else if (WithDstAlpha) { \
+        TempAlpha = CompPtr->Reserved * (255 - Alpha); \
+        Weight = WithPremul ? 255 * 255 : Alpha * 255; \
+        Total = Alpha * 255 + TempAlpha; \
+        CompPtr->Blue = (UINT8) ((Blue * Weight + CompPtr->Blue * TempAlpha) / Total); \
+        CompPtr->Green = (UINT8) ((Green * Weight + CompPtr->Green * TempAlpha) / Total); \
+        CompPtr->Red = (UINT8) ((Red * Weight + CompPtr->Red * TempAlpha) / Total); \
+        CompPtr->Reserved = (UINT8) (Total / 255); \
+      } else { \
+        Weight = WithPremul ? 255 : Alpha; \
+        CompPtr->Blue = (UINT8) ((Blue * Weight + CompPtr->Blue * (255 - Alpha)) / 255); \
+        CompPtr->Green = (UINT8) ((Green * Weight + CompPtr->Green * (255 - Alpha)) / 255); \
+        CompPtr->Red = (UINT8) ((Red * Weight + CompPtr->Red * (255 - Alpha)) / 255); \
+        CompPtr->Reserved = 255; \
+      } \
+    } \
+    TopBasePtr += TopLineOffset; \
+    CompBasePtr += CompLineOffset; \
+  } \
+}
+
+//
+// Listed in table order, the source alpha flag is the lowest bit of the index.
+//
+#define UI_COMPOSE_VARIANTS(Variant) \
+  Variant (0, 0, 0, 0, 0) \
+  Variant (1, 0, 0, 0, 0) \
+  Variant (0, 1, 0, 0, 0) \
+  Variant (1, 1, 0, 0, 0) \
+  Variant (0, 0, 1, 0, 0) \
+  Variant (1, 0, 1, 0, 0) \
+  Variant (0, 1, 1, 0, 0) \
+  Variant (1, 1, 1, 0, 0) \
+  Variant (0, 0, 0, 1, 0) \
+  Variant (1, 0, 0, 1, 0) \
+  Variant (0, 1, 0, 1, 0) \
+  Variant (1, 1, 0, 1, 0) \
+  Variant (0, 0, 1, 1, 0) \
+  Variant (1, 0, 1, 1, 0) \
+  Variant (0, 1, 1, 1, 0) \
+  Variant (1, 1, 1, 1, 0) \
+  Variant (0, 0, 0, 0, 1) \
+  Variant (1, 0, 0, 0, 1) \
+  Variant (0, 1, 0, 0, 1) \
+  Variant (1, 1, 0, 0, 1) \
+  Variant (0, 0, 1, 0, 1) \
+  Variant (1, 0, 1, 0, 1) \
+  Variant (0, 1, 1, 0, 1) \
+  Variant (1, 1, 1, 0, 1) \
+  Variant (0, 0, 0, 1, 1) \
+  Variant (1, 0, 0, 1, 1) \
+  Variant (0, 1, 0, 1, 1) \
+  Variant (1, 1, 0, 1, 1) \
+  Variant (0, 0, 1, 1, 1) \
+  Variant (1, 0, 1, 1, 1) \
+  Variant (0, 1, 1, 1, 1) \
+  Variant (1, 1, 1, 1, 1)
+
+#define UI_COMPOSE_TABLE_ENTRY(WithSrcAlpha, WithDstAlpha, WithOpacity, WithColor, WithPremul) \
+  RawComposeKernel##WithSrcAlpha##WithDstAlpha##WithOpacity##WithColor##WithPremul,
+
+UI_COMPOSE_VARIANTS (UI_COMPOSE_KERNEL)
+
+STATIC
+CONST NDK_UI_COMPOSE_KERNEL
+mComposeKernels[UI_BLEND_KERNELS] = {
+  UI_COMPOSE_VARIANTS (UI_COMPOSE_TABLE_ENTRY)
+};
+
 VOID
-ComposeImage (
+RawComposeEx (
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *CompBasePtr,
+  IN     EFI_GRAPHICS_OUTPUT_BLT_PIXEL *TopBasePtr,
+  IN     INTN                          Width,
+  IN     INTN                          Height,
+  IN     INTN                          CompLineOffset,
+  IN     INTN                          TopLineOffset,
+  IN     CONST NDK_UI_BLEND            *Blend
+  )
+{
+  if (CompBasePtr == NULL || TopBasePtr == NULL || Blend == NULL) {
+    return;
+  }
+  
+  mComposeKernels[Blend->Flags & (UI_BLEND_KERNELS - 1)] (CompBasePtr,
+                                                          TopBasePtr,
+                                                          Width,
+                                                          Height,
+                                                          CompLineOffset,
+                                                          TopLineOffset,
+                                                          Blend
+                                                          );
+}
+
+VOID
+ComposeImageEx (
   IN OUT NDK_UI_IMAGE        *Image,
   IN     NDK_UI_IMAGE        *TopImage,
   IN     INTN                Xpos,
-  IN     INTN                Ypos
+  IN     INTN                Ypos,
+  IN     CONST NDK_UI_BLEND  *Blend OPTIONAL
   )
 {
   INTN                       CompWidth;
   INTN                       CompHeight;
+  NDK_UI_BLEND               Plain;
   
   if (TopImage == NULL || Image == NULL) {
     return;
   }
-
+  
+  //
+  // Without a descriptor the alpha flags follow the two images, as ComposeImage always did.
+  //
+  if (Blend == NULL) {
+    ZeroMem (&Plain, sizeof (Plain));
+    if (TopImage->IsAlpha) {
+      Plain.Flags = UI_BLEND_SRC_ALPHA | (Image->IsAlpha ? UI_BLEND_DST_ALPHA : 0);
+    }
+    Blend = &Plain;
+  }
+  
   CompWidth  = TopImage->Width;
   CompHeight = TopImage->Height;
   RestrictImageArea (Image, Xpos, Ypos, &CompWidth, &CompHeight);
-
+  
   if (CompWidth > 0) {
-    if (TopImage->IsAlpha) {
-      if (Image->IsAlpha) {
-        RawCompose (Image->Bitmap + Ypos * Image->Width + Xpos,
-                    TopImage->Bitmap,
-                    CompWidth,
-                    CompHeight,
-                    Image->Width,
-                    TopImage->Width
-                    );
-      } else {
-        RawComposeOnFlat (Image->Bitmap + Ypos * Image->Width + Xpos,
-                          TopImage->Bitmap,
-                          CompWidth,
-                          CompHeight,
-                          Image->Width,
-                          TopImage->Width
-                          );
-      }
-    } else {
-      RawCopy (Image->Bitmap + Ypos * Image->Width + Xpos,
-               TopImage->Bitmap,
-               CompWidth,
-               CompHeight,
-               Image->Width,
-               TopImage->Width
-               );
-    }
+    RawComposeEx (Image->Bitmap + Ypos * Image->Width + Xpos,
+                  TopImage->Bitmap,
+                  CompWidth,
+                  CompHeight,
+                  Image->Width,
+                  TopImage->Width,
+                  Blend
+                  );
   }
 }
 
+VOID
+ComposeImage (
+  IN OUT NDK_UI_IMAGE        *Image,
+  IN     NDK_UI_IMAGE        *TopImage,
+  IN     INTN                Xpos,
+  IN     INTN                Ypos
+  )
+{
+  ComposeImageEx (Image, TopImage, Xpos, Ypos, NULL);
+}
+
 VOID
 RawCompose (
   IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *CompBasePtr,
@@ -141,49 +447,13 @@ RawCompose (
   IN     INTN                          TopLineOffset
   )
 {
-  INT64                                X;
-  INT64                                Y;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *TopPtr;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *CompPtr;
-  INTN                                 TopAlpha;
-  INTN                                 Alpha;
-  INTN                                 CompAlpha;
-  INTN                                 RevAlpha;
-  INTN                                 TempAlpha;
-
-  if (CompBasePtr == NULL || TopBasePtr == NULL) {
-    return;
-  }
-
-  for (Y = 0; Y < Height; ++Y) {
-    TopPtr = TopBasePtr;
-    CompPtr = CompBasePtr;
-    for (X = 0; X < Width; ++X) {
-      TopAlpha = TopPtr->Reserved & 0xFF;
-      
-      if (TopAlpha == 255) {
-        CompPtr->Blue  = TopPtr->Blue;
-        CompPtr->Green = TopPtr->Green;
-        CompPtr->Red   = TopPtr->Red;
-        CompPtr->Reserved = (UINT8) TopAlpha;
-      } else if (TopAlpha != 0) {
-        CompAlpha = CompPtr->Reserved & 0xFF;
-        RevAlpha = 255 - TopAlpha;
-        TempAlpha = CompAlpha * RevAlpha;
-        TopAlpha *= 255;
-        Alpha = TopAlpha + TempAlpha;
-
-        CompPtr->Blue = (UINT8) ((TopPtr->Blue * TopAlpha + CompPtr->Blue * TempAlpha) / Alpha);
-        CompPtr->Green = (UINT8) ((TopPtr->Green * TopAlpha + CompPtr->Green * TempAlpha) / Alpha);
-        CompPtr->Red = (UINT8) ((TopPtr->Red * TopAlpha + CompPtr->Red * TempAlpha) / Alpha);
-        CompPtr->Reserved = (UINT8) (Alpha / 255);
-      }
-      TopPtr++;
-      CompPtr++;
-    }
-    TopBasePtr += TopLineOffset;
-    CompBasePtr += CompLineOffset;
-  }
+  NDK_UI_BLEND                         Blend;
+  
+  UI_PROFILE_BEGIN (UiProfileRawCompose);
+  ZeroMem (&Blend, sizeof (Blend));
+  Blend.Flags = UI_BLEND_SRC_ALPHA | UI_BLEND_DST_ALPHA;
+  RawComposeEx (CompBasePtr, TopBasePtr, Width, Height, CompLineOffset, TopLineOffset, &Blend);
+  UI_PROFILE_END (UiProfileRawCompose);
 }
 
 VOID
@@ -196,42 +466,13 @@ RawComposeOnFlat (
   IN     INTN                          TopLineOffset
   )
 {
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *TopPtr;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *CompPtr;
-  UINT32                               TopAlpha;
-  UINT32                               RevAlpha;
-  UINTN                                Temp;
-  INT64                                X;
-  INT64                                Y;
-
-  if (CompBasePtr == NULL || TopBasePtr == NULL) {
-    return;
-  }
-
-  for (Y = 0; Y < Height; ++Y) {
-    TopPtr = TopBasePtr;
-    CompPtr = CompBasePtr;
-    for (X = 0; X < Width; ++X) {
-      TopAlpha = TopPtr->Reserved;
-      RevAlpha = 255 - TopAlpha;
-
-      Temp = ((UINT8) CompPtr->Blue * RevAlpha) + ((UINT8) TopPtr->Blue * TopAlpha);
-      CompPtr->Blue = (UINT8) (Temp / 255);
-
-      Temp = ((UINT8) CompPtr->Green * RevAlpha) + ((UINT8) TopPtr->Green * TopAlpha);
-      CompPtr->Green = (UINT8) (Temp / 255);
-
-      Temp = ((UINT8) CompPtr->Red * RevAlpha) + ((UINT8) TopPtr->Red * TopAlpha);
-      CompPtr->Red = (UINT8) (Temp / 255);
-
-      CompPtr->Reserved = (UINT8)(255);
-
-      TopPtr++;
-      CompPtr++;
-    }
-    TopBasePtr += TopLineOffset;
-    CompBasePtr += CompLineOffset;
-  }
+  NDK_UI_BLEND                         Blend;
+  
+  UI_PROFILE_BEGIN (UiProfileRawComposeOnFlat);
+  ZeroMem (&Blend, sizeof (Blend));
+  Blend.Flags = UI_BLEND_SRC_ALPHA;
+  RawComposeEx (CompBasePtr, TopBasePtr, Width, Height, CompLineOffset, TopLineOffset, &Blend);
+  UI_PROFILE_END (UiProfileRawComposeOnFlat);
 }
 
 VOID
@@ -244,24 +485,10 @@ RawCopy (
   IN     INTN                          TopLineOffset
   )
 {
-  INTN       X;
-  INTN       Y;
-
-  if (CompBasePtr == NULL || TopBasePtr == NULL) {
-    return;
-  }
-
-  for (Y = 0; Y < Height; ++Y) {
-    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *TopPtr = TopBasePtr;
-    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *CompPtr = CompBasePtr;
-    for (X = 0; X < Width; ++X) {
-      *CompPtr = *TopPtr;
-      TopPtr++;
-      CompPtr++;
-    }
-    TopBasePtr += TopLineOffset;
-    CompBasePtr += CompLineOffset;
-  }
+  NDK_UI_BLEND                         Blend;
+  
+  ZeroMem (&Blend, sizeof (Blend));
+  RawComposeEx (CompBasePtr, TopBasePtr, Width, Height, CompLineOffset, TopLineOffset, &Blend);
 }
 
 VOID
@@ -275,46 +502,14 @@ RawComposeAlpha (
   IN     INTN                          Opacity
   )
 {
-  INTN       X;
-  INTN       Y;
-  INTN       Alpha;
-  INTN       InvAlpha;
-  INTN       TopAlpha;
-
-  if (CompBasePtr == NULL || TopBasePtr == NULL) {
-    return;
-  }
-  
-  if (Opacity == 0) {
-    RawCompose (CompBasePtr,
-                TopBasePtr,
-                Width,
-                Height,
-                CompLineOffset,
-                TopLineOffset
-                );
-    return;
-  }
+  NDK_UI_BLEND                         Blend;
   
-  for (Y = 0; Y < Height; ++Y) {
-    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *TopPtr = TopBasePtr;
-    EFI_GRAPHICS_OUTPUT_BLT_PIXEL *CompPtr = CompBasePtr;
-    for (X = 0; X < Width; ++X) {
-      TopAlpha = TopPtr->Reserved & 0xFF;
-      if (TopAlpha != 0) {
-        Alpha =  (Opacity * TopAlpha) / 255;
-        InvAlpha = 255 - ((Opacity * TopAlpha) / 255);
-        CompPtr->Blue = (UINT8) ((TopPtr->Blue * Alpha + CompPtr->Blue * InvAlpha) >> 8);
-        CompPtr->Green = (UINT8) ((TopPtr->Green * Alpha + CompPtr->Green * InvAlpha) >> 8);
-        CompPtr->Red = (UINT8) ((TopPtr->Red * Alpha + CompPtr->Red * InvAlpha) >> 8);
-        CompPtr->Reserved = (UINT8) (255);
-      }
-      TopPtr++;
-      CompPtr++;
-    }
-    TopBasePtr += TopLineOffset;
-    CompBasePtr += CompLineOffset;
-  }
+  UI_PROFILE_BEGIN (UiProfileRawComposeAlpha);
+  ZeroMem (&Blend, sizeof (Blend));
+  Blend.Flags = (Opacity == 0) ? (UI_BLEND_SRC_ALPHA | UI_BLEND_DST_ALPHA) : (UI_BLEND_SRC_ALPHA | UI_BLEND_OPACITY);
+  Blend.Opacity = Opacity;
+  RawComposeEx (CompBasePtr, TopBasePtr, Width, Height, CompLineOffset, TopLineOffset, &Blend);
+  UI_PROFILE_END (UiProfileRawComposeAlpha);
 }
 
 VOID
@@ -328,67 +523,77 @@ RawComposeColor (
   IN     INTN                          ColorDiff
   )
 {
-  INT64                                X;
-  INT64                                Y;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *TopPtr;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *CompPtr;
-  INTN                                 TopAlpha;
-  INTN                                 Alpha;
-  INTN                                 CompAlpha;
-  INTN                                 RevAlpha;
-  INTN                                 TempAlpha;
-  INTN                                 TempColor;
-  INTN                                 Base;
+  NDK_UI_BLEND                         Blend;
+  
+  UI_PROFILE_BEGIN (UiProfileRawComposeColor);
+  ZeroMem (&Blend, sizeof (Blend));
+  Blend.Flags = UI_BLEND_SRC_ALPHA | UI_BLEND_DST_ALPHA | (ColorDiff != 0 ? UI_BLEND_COLOR : 0);
+  Blend.ColorDiff = ColorDiff;
+  RawComposeEx (CompBasePtr, TopBasePtr, Width, Height, CompLineOffset, TopLineOffset, &Blend);
+  UI_PROFILE_END (UiProfileRawComposeColor);
+}
 
-  if (CompBasePtr == NULL || TopBasePtr == NULL) {
-    return;
+STATIC
+VOID
+ReplicatePixels (
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BasePtr,
+  IN     INTN                          Filled,
+  IN     INTN                          Count
+  )
+{
+  INTN                                 Length;
+  
+  //
+  // The filled part is a whole number of periods, so doubling it keeps the pattern in phase.
+  //
+  while (Filled < Count) {
+    Length = MIN (Filled, Count - Filled);
+    CopyMem (BasePtr + Filled, BasePtr, Length * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    Filled += Length;
   }
+}
+
+VOID
+TileImageArea (
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *DestPtr,
+  IN     INTN                          DestLineOffset,
+  IN     INTN                          Width,
+  IN     INTN                          Height,
+  IN     NDK_UI_IMAGE                  *Pattern,
+  IN     INTN                          PatternX,
+  IN     INTN                          PatternY
+  )
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *SrcRow;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *RowPtr;
+  INTN                                 Period;
+  INTN                                 Head;
+  INTN                                 y;
   
-  if (ColorDiff == 0) {
-    RawCompose (CompBasePtr,
-                TopBasePtr,
-                Width,
-                Height,
-                CompLineOffset,
-                TopLineOffset
-                );
+  if (DestPtr == NULL || Pattern == NULL || Width <= 0 || Height <= 0) {
     return;
-  } else if (ColorDiff > 0) {
-    Base = 255;
-  } else {
-    Base = 0;
-  }
-  
-  for (Y = 0; Y < Height; ++Y) {
-    TopPtr = TopBasePtr;
-    CompPtr = CompBasePtr;
-    for (X = 0; X < Width; ++X) {
-      TopAlpha = TopPtr->Reserved & 0xFF;
-      if (TopAlpha == 255) {
-        TempColor = Base == 0 ? TopPtr->Blue + (TopPtr->Blue * ColorDiff / 255) : MIN (TopPtr->Blue + (TopPtr->Blue * ColorDiff / 255), Base);
-        CompPtr->Blue  = (UINT8) TempColor;
-        TempColor = Base == 0 ? TopPtr->Green + (TopPtr->Green * ColorDiff / 255) : MIN (TopPtr->Green + (TopPtr->Green * ColorDiff / 255), Base);
-        CompPtr->Green = (UINT8) TempColor;
-        TempColor = Base == 0 ? TopPtr->Red + (TopPtr->Red * ColorDiff / 255) : MIN (TopPtr->Red + (TopPtr->Red * ColorDiff / 255), Base);
-        CompPtr->Red   = (UINT8) TempColor;
-        CompPtr->Reserved = (UINT8) TopAlpha;
-      } else if (TopAlpha != 0) {
-        CompAlpha = CompPtr->Reserved & 0xFF;
-        RevAlpha = 255 - TopAlpha;
-        TempAlpha = CompAlpha * RevAlpha;
-        TopAlpha *= 255;
-        Alpha = TopAlpha + TempAlpha;
-
-        CompPtr->Blue = (UINT8) ((Base == 0 ? TopPtr->Blue + (TopPtr->Blue * ColorDiff / 255) : MIN (TopPtr->Blue + (TopPtr->Blue * ColorDiff / 255), Base) * TopAlpha + CompPtr->Blue * TempAlpha) / Alpha);
-        CompPtr->Green = (UINT8) ((Base == 0 ? TopPtr->Green + (TopPtr->Green * ColorDiff / 255) : MIN (TopPtr->Green + (TopPtr->Green * ColorDiff / 255), Base) * TopAlpha + CompPtr->Green * TempAlpha) / Alpha);
-        CompPtr->Red = (UINT8) ((Base == 0 ? TopPtr->Red + (TopPtr->Red * ColorDiff / 255) : MIN (TopPtr->Red + (TopPtr->Red * ColorDiff / 255), Base) * TopAlpha + CompPtr->Red * TempAlpha) / Alpha);
-        CompPtr->Reserved = (UINT8) (Alpha / 255);
-      }
-      TopPtr++;
-      CompPtr++;
+  }
+  
+  PatternX %= Pattern->Width;
+  PatternY %= Pattern->Height;
+  Period = MIN (Pattern->Width, Width);
+  Head = MIN (Pattern->Width - PatternX, Period);
+  
+  //
+  // Only the first pattern height of rows is built from the source, every later row
+  // is a copy of the finished row one period above it.
+  //
+  RowPtr = DestPtr;
+  for (y = 0; y < Height; y++) {
+    if (y < Pattern->Height) {
+      SrcRow = Pattern->Bitmap + ((y + PatternY) % Pattern->Height) * Pattern->Width;
+      CopyMem (RowPtr, SrcRow + PatternX, Head * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+      CopyMem (RowPtr + Head, SrcRow, (Period - Head) * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+      ReplicatePixels (RowPtr, Period, Width);
+    } else {
+      CopyMem (RowPtr, RowPtr - Pattern->Height * DestLineOffset, Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
     }
-    TopBasePtr += TopLineOffset;
-    CompBasePtr += CompLineOffset;
+    RowPtr += DestLineOffset;
   }
 }
 
@@ -399,8 +604,6 @@ FillImage (
   )
 {
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL        FillColor;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *PixelPtr;
-  INTN                                 Index;
   
   if (Image == NULL || Color == NULL) {
     return;
@@ -413,10 +616,7 @@ FillImage (
 
   FillColor = *Color;
 
-  PixelPtr = Image->Bitmap;
-  for (Index = 0; Index < Image->Width * Image->Height; ++Index) {
-    *PixelPtr++ = FillColor;
-  }
+  SetMem32 (Image->Bitmap, (UINTN) Image->Width * Image->Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL), *(UINT32 *) &FillColor);
 }
 
 NDK_UI_IMAGE *
@@ -458,6 +658,57 @@ CopyImage (
   return NewImage;
 }
 
+VOID
+ScaleImageArea (
+  IN OUT NDK_UI_IMAGE      *DestImage,
+  IN     INTN              DestX,
+  IN     INTN              DestY,
+  IN     NDK_UI_IMAGE      *SrcImage,
+  IN     INTN              Ratio,
+  IN     INTN              ScaledX,
+  IN     INTN              ScaledY,
+  IN     INTN              Width,
+  IN     INTN              Height
+  )
+{
+  INTN                                x, x0, x1, x2, y, y0, y1, y2;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *Dest;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *Src;
+  INTN                                OldW;
+  
+  if (DestImage == NULL || SrcImage == NULL || Ratio <= 0) {
+    return;
+  }
+  
+  Src = SrcImage->Bitmap;
+  OldW = SrcImage->Width;
+  
+  //
+  // Only the requested window of the scaled image is computed, each destination row
+  // reads at most three source rows.
+  //
+  for (y = ScaledY; y < ScaledY + Height; y++) {
+    Dest = DestImage->Bitmap + (DestY + y - ScaledY) * DestImage->Width + DestX;
+    y1 = (y << 4) / Ratio;
+    y0 = ((y1 > 0) ? (y1-1) : y1) * OldW;
+    y2 = ((y1 < (SrcImage->Height - 1)) ? (y1+1) : y1) * OldW;
+    y1 *= OldW;
+    for (x = ScaledX; x < ScaledX + Width; x++) {
+      x1 = (x << 4) / Ratio;
+      x0 = (x1 > 0) ? (x1 - 1) : x1;
+      x2 = (x1 < (OldW - 1)) ? (x1+1) : x1;
+      Dest->Blue = (UINT8)(((INTN)Src[x1+y1].Blue * 2 + Src[x0+y1].Blue +
+                         Src[x2+y1].Blue + Src[x1+y0].Blue + Src[x1+y2].Blue) / 6);
+      Dest->Green = (UINT8)(((INTN)Src[x1+y1].Green * 2 + Src[x0+y1].Green +
+                         Src[x2+y1].Green + Src[x1+y0].Green + Src[x1+y2].Green) / 6);
+      Dest->Red = (UINT8)(((INTN)Src[x1+y1].Red * 2 + Src[x0+y1].Red +
+                         Src[x2+y1].Red + Src[x1+y0].Red + Src[x1+y2].Red) / 6);
+      Dest->Reserved = Src[x1+y1].Reserved;
+      Dest++;
+    }
+  }
+}
+
 NDK_UI_IMAGE *
 CopyScaledImage (
   IN NDK_UI_IMAGE      *OldImage,
@@ -466,11 +717,9 @@ CopyScaledImage (
 {
   BOOLEAN                             Grey = FALSE;
   NDK_UI_IMAGE                        *NewImage;
-  INTN                                x, x0, x1, x2, y, y0, y1, y2;
+  INTN                                x, y;
   INTN                                NewH, NewW;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *Dest;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *Src;
-  INTN                                OldW;
 
   if (Ratio < 0) {
     Ratio = -Ratio;
@@ -480,8 +729,7 @@ CopyScaledImage (
   if (OldImage == NULL) {
     return NULL;
   }
-  Src =  OldImage->Bitmap;
-  OldW = OldImage->Width;
+  UI_PROFILE_BEGIN (UiProfileCopyScaledImage);
 
   NewW = (OldImage->Width * Ratio) >> 4;
   NewH = (OldImage->Height * Ratio) >> 4;
@@ -492,28 +740,10 @@ CopyScaledImage (
   } else {
     NewImage = CreateImage (NewW, NewH, OldImage->IsAlpha);
     if (NewImage == NULL) {
+      UI_PROFILE_END (UiProfileCopyScaledImage);
       return NULL;
     }
-    Dest = NewImage->Bitmap;
-    for (y = 0; y < NewH; y++) {
-      y1 = (y << 4) / Ratio;
-      y0 = ((y1 > 0) ? (y1-1) : y1) * OldW;
-      y2 = ((y1 < (OldImage->Height - 1)) ? (y1+1) : y1) * OldW;
-      y1 *= OldW;
-      for (x = 0; x < NewW; x++) {
-        x1 = (x << 4) / Ratio;
-        x0 = (x1 > 0) ? (x1 - 1) : x1;
-        x2 = (x1 < (OldW - 1)) ? (x1+1) : x1;
-        Dest->Blue = (UINT8)(((INTN)Src[x1+y1].Blue * 2 + Src[x0+y1].Blue +
-                           Src[x2+y1].Blue + Src[x1+y0].Blue + Src[x1+y2].Blue) / 6);
-        Dest->Green = (UINT8)(((INTN)Src[x1+y1].Green * 2 + Src[x0+y1].Green +
-                           Src[x2+y1].Green + Src[x1+y0].Green + Src[x1+y2].Green) / 6);
-        Dest->Red = (UINT8)(((INTN)Src[x1+y1].Red * 2 + Src[x0+y1].Red +
-                           Src[x2+y1].Red + Src[x1+y0].Red + Src[x1+y2].Red) / 6);
-        Dest->Reserved = Src[x1+y1].Reserved;
-        Dest++;
-      }
-    }
+    ScaleImageArea (NewImage, 0, 0, OldImage, Ratio, 0, 0, NewW, NewH);
   }
   if (Grey) {
     Dest = NewImage->Bitmap;
@@ -526,9 +756,255 @@ CopyScaledImage (
     }
   }
 
+  UI_PROFILE_END (UiProfileCopyScaledImage);
   return NewImage;
 }
 
+STATIC
+VOID
+HalveImage (
+  IN     NDK_UI_IMAGE      *Image,
+  IN OUT NDK_UI_IMAGE      *NewImage
+  )
+{
+  INTN                                x, y;
+  INTN                                NewW, NewH;
+  UINTN                               Alpha;
+  UINTN                               Index;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *Src[4];
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *Dest;
+  
+  NewW = NewImage->Width;
+  NewH = NewImage->Height;
+  Dest = NewImage->Bitmap;
+  for (y = 0; y < NewH; y++) {
+    Src[0] = Image->Bitmap + (y << 1) * Image->Width;
+    Src[1] = Src[0] + 1;
+    Src[2] = Src[0] + Image->Width;
+    Src[3] = Src[2] + 1;
+    for (x = 0; x < NewW; x++) {
+      if (!Image->IsAlpha) {
+        Dest->Blue = (UINT8) ((Src[0]->Blue + Src[1]->Blue + Src[2]->Blue + Src[3]->Blue + 2) >> 2);
+        Dest->Green = (UINT8) ((Src[0]->Green + Src[1]->Green + Src[2]->Green + Src[3]->Green + 2) >> 2);
+        Dest->Red = (UINT8) ((Src[0]->Red + Src[1]->Red + Src[2]->Red + Src[3]->Red + 2) >> 2);
+        Dest->Reserved = (UINT8) ((Src[0]->Reserved + Src[1]->Reserved + Src[2]->Reserved + Src[3]->Reserved + 2) >> 2);
+      } else {
+        //
+        // Colours are weighted by their alpha, so transparent pixels do not darken the edges.
+        //
+        Alpha = (UINTN) Src[0]->Reserved + Src[1]->Reserved + Src[2]->Reserved + Src[3]->Reserved;
+        if (Alpha == 0) {
+          ZeroMem (Dest, sizeof (*Dest));
+        } else {
+          Dest->Blue = (UINT8) (((UINTN) Src[0]->Blue * Src[0]->Reserved + (UINTN) Src[1]->Blue * Src[1]->Reserved
+                                + (UINTN) Src[2]->Blue * Src[2]->Reserved + (UINTN) Src[3]->Blue * Src[3]->Reserved
+                                + (Alpha >> 1)) / Alpha);
+          Dest->Green = (UINT8) (((UINTN) Src[0]->Green * Src[0]->Reserved + (UINTN) Src[1]->Green * Src[1]->Reserved
+                                 + (UINTN) Src[2]->Green * Src[2]->Reserved + (UINTN) Src[3]->Green * Src[3]->Reserved
+                                 + (Alpha >> 1)) / Alpha);
+          Dest->Red = (UINT8) (((UINTN) Src[0]->Red * Src[0]->Reserved + (UINTN) Src[1]->Red * Src[1]->Reserved
+                               + (UINTN) Src[2]->Red * Src[2]->Reserved + (UINTN) Src[3]->Red * Src[3]->Reserved
+                               + (Alpha >> 1)) / Alpha);
+          Dest->Reserved = (UINT8) ((Alpha + 2) >> 2);
+        }
+      }
+      for (Index = 0; Index < 4; Index++) {
+        Src[Index] += 2;
+      }
+      Dest++;
+    }
+  }
+}
+
+VOID
+AllocateMipChain (
+  IN  NDK_UI_IMAGE      *Image,
+  OUT NDK_UI_MIP_CHAIN  *Chain
+  )
+{
+  UINTN                 Level;
+  NDK_UI_IMAGE          *Upper;
+  
+  ZeroMem (Chain, sizeof (*Chain));
+  Chain->Levels[0] = Image;
+  if (Image == NULL) {
+    return;
+  }
+  
+  //
+  // A missing level just falls back to scaling.
+  //
+  for (Level = 1; Level < UI_MIP_LEVELS; Level++) {
+    Upper = Chain->Levels[Level - 1];
+    if (Upper->Width < 2 || Upper->Height < 2) {
+      break;
+    }
+    Chain->Levels[Level] = CreateImage (Upper->Width >> 1, Upper->Height >> 1, Upper->IsAlpha);
+    if (Chain->Levels[Level] == NULL) {
+      break;
+    }
+  }
+}
+
+VOID
+FillMipChain (
+  IN OUT NDK_UI_MIP_CHAIN  *Chain
+  )
+{
+  UINTN                    Level;
+  
+  //
+  // Each level is a 2x2 box filter of the one above. Levels are allocated up front,
+  // so this only computes and may run on application processors.
+  //
+  for (Level = 1; Level < UI_MIP_LEVELS && Chain->Levels[Level] != NULL; Level++) {
+    HalveImage (Chain->Levels[Level - 1], Chain->Levels[Level]);
+  }
+}
+
+VOID
+BuildMipChain (
+  IN  NDK_UI_IMAGE      *Image,
+  OUT NDK_UI_MIP_CHAIN  *Chain
+  )
+{
+  AllocateMipChain (Image, Chain);
+  FillMipChain (Chain);
+}
+
+VOID
+FreeMipChain (
+  IN OUT NDK_UI_MIP_CHAIN  *Chain
+  )
+{
+  UINTN                    Level;
+  
+  //
+  // The first level is the source image and stays with its owner.
+  //
+  for (Level = 1; Level < UI_MIP_LEVELS; Level++) {
+    FreeImage (Chain->Levels[Level]);
+    Chain->Levels[Level] = NULL;
+  }
+  Chain->Levels[0] = NULL;
+}
+
+NDK_UI_IMAGE *
+CopyMipImage (
+  IN NDK_UI_MIP_CHAIN  *Chain,
+  IN INTN              Ratio
+  )
+{
+  UINTN                Level;
+  
+  Level = (Ratio == 16) ? 0 : (Ratio == 8) ? 1 : (Ratio == 4) ? 2 : UI_MIP_LEVELS;
+  if (Level < UI_MIP_LEVELS && Chain->Levels[Level] != NULL) {
+    return CopyImage (Chain->Levels[Level]);
+  }
+  
+  return CopyScaledImage (Chain->Levels[0], Ratio);
+}
+
+STATIC
+VOID
+BlendFillRow (
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *DestPtr,
+  IN     INTN                          Width,
+  IN     EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Fill
+  )
+{
+  UINT32                               FillAlpha;
+  UINT32                               RevAlpha;
+  INTN                                 X;
+  
+  FillAlpha = Fill->Reserved;
+  RevAlpha = 255 - FillAlpha;
+  if (FillAlpha == 0) {
+    return;
+  }
+  
+  for (X = 0; X < Width; ++X) {
+    if (FillAlpha == 255) {
+      DestPtr->Blue  = Fill->Blue;
+      DestPtr->Green = Fill->Green;
+      DestPtr->Red   = Fill->Red;
+    } else {
+      DestPtr->Blue  = (UINT8) ((DestPtr->Blue * RevAlpha + Fill->Blue * FillAlpha) / 255);
+      DestPtr->Green = (UINT8) ((DestPtr->Green * RevAlpha + Fill->Green * FillAlpha) / 255);
+      DestPtr->Red   = (UINT8) ((DestPtr->Red * RevAlpha + Fill->Red * FillAlpha) / 255);
+    }
+    DestPtr->Reserved = 255;
+    DestPtr++;
+  }
+}
+
+VOID
+ScaleComposeArea (
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *DestPtr,
+  IN     INTN                          DestLineOffset,
+  IN     EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Fill OPTIONAL,
+  IN     NDK_UI_IMAGE                  *SrcImage OPTIONAL,
+  IN     INTN                          Ratio,
+  IN     INTN                          Width,
+  IN     INTN                          Height
+  )
+{
+  NDK_UI_IMAGE                         *Row;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *SrcPtr;
+  INTN                                 SrcWidth;
+  INTN                                 SrcHeight;
+  INTN                                 y;
+  
+  if (DestPtr == NULL || Width <= 0 || Height <= 0 || Ratio <= 0) {
+    return;
+  }
+  UI_PROFILE_BEGIN (UiProfileScaleComposeArea);
+  
+  SrcWidth = 0;
+  SrcHeight = 0;
+  if (SrcImage != NULL) {
+    SrcWidth = MIN (Width, (SrcImage->Width * Ratio) >> 4);
+    SrcHeight = MIN (Height, (SrcImage->Height * Ratio) >> 4);
+  }
+  
+  //
+  // Scaled sources are sampled one row at a time into a single scratch row,
+  // so the scaled image never exists as a whole.
+  //
+  Row = NULL;
+  if (SrcWidth > 0 && Ratio != 16) {
+    Row = CreateImage ((UINT16) SrcWidth, 1, SrcImage->IsAlpha);
+    if (Row == NULL) {
+      SrcHeight = 0;
+    }
+  }
+  
+  for (y = 0; y < Height; y++) {
+    if (Fill != NULL) {
+      BlendFillRow (DestPtr, Width, Fill);
+    }
+  
+    if (y < SrcHeight && SrcWidth > 0) {
+      if (Row != NULL) {
+        ScaleImageArea (Row, 0, 0, SrcImage, Ratio, 0, y, SrcWidth, 1);
+        SrcPtr = Row->Bitmap;
+      } else {
+        SrcPtr = SrcImage->Bitmap + y * SrcImage->Width;
+      }
+  
+      if (SrcImage->IsAlpha) {
+        RawComposeOnFlat (DestPtr, SrcPtr, SrcWidth, 1, 0, 0);
+      } else {
+        RawCopy (DestPtr, SrcPtr, SrcWidth, 1, 0, 0);
+      }
+    }
+    DestPtr += DestLineOffset;
+  }
+  
+  FreeImage (Row);
+  UI_PROFILE_END (UiProfileScaleComposeArea);
+}
+
 VOID
 BltImage (
   IN NDK_UI_IMAGE        *Image,
@@ -543,26 +1019,70 @@ BltImage (
   DrawImageArea (Image, 0, 0, 0, 0, Xpos, Ypos);
 }
 
+EFI_STATUS
+GetPngDimensions (
+  IN  VOID                         *Buffer,
+  IN  UINT32                       BufferSize,
+  OUT UINT32                       *Width,
+  OUT UINT32                       *Height
+  )
+{
+  UINT8                            *Header;
+  
+  //
+  // The signature is followed by the IHDR chunk, which starts with big endian width and height.
+  //
+  Header = (UINT8 *) Buffer;
+  if (Buffer == NULL || BufferSize < 24
+      || Header[0] != 0x89 || Header[1] != 'P' || Header[2] != 'N' || Header[3] != 'G'
+      || CompareMem (Header + 12, "IHDR", 4) != 0) {
+    return EFI_UNSUPPORTED;
+  }
+  
+  *Width = SwapBytes32 (ReadUnaligned32 ((UINT32 *) (Header + 16)));
+  *Height = SwapBytes32 (ReadUnaligned32 ((UINT32 *) (Header + 20)));
+  return EFI_SUCCESS;
+}
+
+VOID
+SwizzleImage (
+  IN OUT NDK_UI_IMAGE              *Image
+  )
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *Pixel;
+  UINTN                            Index;
+  UINT8                            Swap;
+  
+  //
+  // The decoder returns 8-bit RGBA, which has the size of a BGRA blt pixel, so red and blue
+  // are swapped in place. Nothing here allocates, application processors may run it.
+  //
+  Pixel = Image->Bitmap;
+  for (Index = 0; Index < (UINTN) Image->Width * Image->Height; Index++) {
+    Swap = Pixel->Blue;
+    Pixel->Blue = Pixel->Red;
+    Pixel->Red = Swap;
+    Pixel++;
+  }
+}
+
 NDK_UI_IMAGE *
-DecodePNG (
+DecodePNGRgba (
   IN VOID                          *Buffer,
   IN UINT32                        BufferSize
   )
 {
   EFI_STATUS                       Status;
   NDK_UI_IMAGE                     *NewImage;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *Pixel;
   VOID                             *Data;
   UINT32                           Width;
   UINT32                           Height;
-  UINT8                            *DataWalker;
-  UINTN                            X;
-  UINTN                            Y;
   BOOLEAN                          IsAlpha;
   
   if (Buffer == NULL) {
     return NULL;
   }
+  UI_PROFILE_BEGIN (UiProfileDecodePng);
   
   Status = DecodePng (
                Buffer,
@@ -572,42 +1092,51 @@ DecodePNG (
                &Height,
                &IsAlpha
               );
+  //
+  // The compressed file is no longer needed, release it before the image is built.
+  //
+  FreePool (Buffer);
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_INFO, "OCUI: DecodePNG...%r\n", Status));
-    if (Buffer != NULL) {
-      FreePool (Buffer);
-    }
+    UI_PROFILE_END (UiProfileDecodePng);
     return NULL;
   }
-    
-  NewImage = CreateImage ((INTN) Width, (INTN) Height, IsAlpha);
-  if (NewImage == NULL) {
-    if (Buffer != NULL) {
-      FreePool (Buffer);
+  
+  NewImage = AllocateZeroPool (sizeof (NDK_UI_IMAGE));
+  if (NewImage == NULL || Width == 0 || Height == 0 || Width > MAX_UINT16 || Height > MAX_UINT16) {
+    if (NewImage != NULL) {
+      FreePool (NewImage);
     }
+    FreePool (Data);
+    UI_PROFILE_END (UiProfileDecodePng);
     return NULL;
   }
   
-  Pixel = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) NewImage->Bitmap;
-  DataWalker = (UINT8 *) Data;
-  for (Y = 0; Y < NewImage->Height; Y++) {
-    for (X = 0; X < NewImage->Width; X++) {
-      Pixel->Red = *DataWalker++;
-      Pixel->Green = *DataWalker++;
-      Pixel->Blue = *DataWalker++;
-      Pixel->Reserved = *DataWalker++;
-      Pixel++;
-    }
-  }
+  //
+  // The decoded buffer is adopted instead of copied, it is still RGBA until swizzled.
+  //
+  NewImage->Width = (UINT16) Width;
+  NewImage->Height = (UINT16) Height;
+  NewImage->IsAlpha = IsAlpha;
+  NewImage->Bitmap = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) Data;
+  mImageBytes += (UINTN) Width * Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
   
-  if (Buffer != NULL) {
-    FreePool (Buffer);
-  }
+  UI_PROFILE_END (UiProfileDecodePng);
+  return NewImage;
+}
+
+NDK_UI_IMAGE *
+DecodePNG (
+  IN VOID                          *Buffer,
+  IN UINT32                        BufferSize
+  )
+{
+  NDK_UI_IMAGE                     *NewImage;
   
-  if (Data != NULL) {
-    FreePool (Data);
+  NewImage = DecodePNGRgba (Buffer, BufferSize);
+  if (NewImage != NULL) {
+    SwizzleImage (NewImage);
   }
   
-  NewImage->IsAlpha = IsAlpha;
   return NewImage;
 }
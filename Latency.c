@@ -0,0 +1,130 @@
+//
+//  Latency.c
+//
+
+#include <NdkBootPicker.h>
+
+STATIC
+CONST CHAR8 *
+mInputEventNames[UiInputEventMax] = {
+  "Arrow",
+  "IndexKey",
+  "Tab",
+  "PointerHover",
+  "Click"
+};
+
+STATIC
+NDK_UI_LATENCY_HISTOGRAM
+mLatency[UiInputEventMax];
+
+STATIC
+NDK_UI_INPUT_EVENT
+mLatencyEvent = UiInputEventMax;
+
+STATIC
+UINT64
+mLatencyStart;
+
+VOID
+ResetLatency (
+  VOID
+  )
+{
+  ZeroMem (mLatency, sizeof (mLatency));
+  mLatencyEvent = UiInputEventMax;
+}
+
+VOID
+LatencyBegin (
+  IN NDK_UI_INPUT_EVENT  Event,
+  IN UINT64              InputTicks
+  )
+{
+  mLatencyEvent = Event;
+  mLatencyStart = InputTicks;
+}
+
+VOID
+LatencyEnd (
+  IN UINT64              LastBltTicks
+  )
+{
+  NDK_UI_LATENCY_HISTOGRAM  *Histogram;
+  UINT64                    Latency;
+  UINTN                     Bucket;
+  
+  if (mLatencyEvent == UiInputEventMax) {
+    return;
+  }
+  
+  //
+  // An input that did not change the screen has nothing to measure.
+  //
+  if (LastBltTicks > mLatencyStart) {
+    Histogram = &mLatency[mLatencyEvent];
+    Latency = DivU64x32 (GetTimeInNanoSecond (LastBltTicks - mLatencyStart), 1000);
+    Bucket = (UINTN) (HighBitSet64 (DivU64x32 (Latency, 1000)) + 1);
+    ++Histogram->Buckets[MIN (Bucket, UI_LATENCY_BUCKETS - 1)];
+    ++Histogram->Count;
+    Histogram->Total += Latency;
+    Histogram->Max = MAX (Histogram->Max, Latency);
+  }
+  
+  mLatencyEvent = UiInputEventMax;
+}
+
+CHAR8 *
+LatencyReport (
+  OUT UINTN            *ReportSize
+  )
+{
+  CHAR8                *Report;
+  UINTN                BufferSize;
+  UINTN                Length;
+  UINTN                Index;
+  UINTN                Bucket;
+  
+  *ReportSize = 0;
+  BufferSize = (UiInputEventMax + 1) * UI_LATENCY_LINE;
+  Report = AllocateZeroPool (BufferSize);
+  if (Report == NULL) {
+    return NULL;
+  }
+  
+  Length = AsciiSPrint (Report, BufferSize, "Event,Count,AvgMicroSeconds,MaxMicroSeconds");
+  for (Bucket = 0; Bucket < UI_LATENCY_BUCKETS - 1; ++Bucket) {
+    Length += AsciiSPrint (Report + Length, BufferSize - Length, ",<%ums", 1U << Bucket);
+  }
+  Length += AsciiSPrint (Report + Length, BufferSize - Length, ",More\n");
+  
+  for (Index = 0; Index < UiInputEventMax; ++Index) {
+    if (mLatency[Index].Count == 0) {
+      continue;
+    }
+    
+    DEBUG ((DEBUG_INFO, "OCUI: Latency %a - %u events, avg %lu us, max %lu us\n",
+            mInputEventNames[Index],
+            mLatency[Index].Count,
+            DivU64x32 (mLatency[Index].Total, mLatency[Index].Count),
+            mLatency[Index].Max
+            ));
+    
+    Length += AsciiSPrint (Report + Length,
+                           BufferSize - Length,
+                           "%a,%u,%lu,%lu",
+                           mInputEventNames[Index],
+                           mLatency[Index].Count,
+                           DivU64x32 (mLatency[Index].Total, mLatency[Index].Count),
+                           mLatency[Index].Max
+                           );
+    for (Bucket = 0; Bucket < UI_LATENCY_BUCKETS; ++Bucket) {
+      Length += AsciiSPrint (Report + Length, BufferSize - Length, ",%u", mLatency[Index].Buckets[Bucket]);
+    }
+    Length += AsciiSPrint (Report + Length, BufferSize - Length, "\n");
+  }
+  
+  *ReportSize = Length;
+  
+  return Report;
+}
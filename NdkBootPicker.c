@@ -28,6 +28,38 @@ STATIC
 INTN
 mMenuIconsCount;
 
+STATIC
+UINTN
+mIconsPerRow;
+
+STATIC
+UINTN
+mMenuRows;
+
+STATIC
+UINTN
+mMenuTopRow;
+
+STATIC
+INTN
+mMenuColorDiff = ICON_BRIGHTNESS_FULL;
+
+STATIC
+INTN
+mSelectedIcon = -1;
+
+STATIC
+NDK_UI_TILE
+mSelectedTile = UiTileNormal;
+
+STATIC
+UINTN
+mTimeOutStart;
+
+STATIC
+UINTN
+mTimeOutShown;
+
 /*========== Pointer Setting ==========*/
 
 POINTERS mPointer = {NULL, NULL, NULL, NULL, NULL,
@@ -39,6 +71,38 @@ STATIC
 UINT32
 mPointerSpeed = 0;
 
+STATIC
+UINT64
+mPointerPolls = 0;
+
+STATIC
+UINT64
+mInputTicks = 0;
+
+STATIC
+BOOLEAN
+mInputFromPointer = FALSE;
+
+STATIC
+BOOLEAN
+mHudVisible = FALSE;
+
+STATIC
+UINT64
+mHudLastUpdate = 0;
+
+STATIC
+UINT64
+mHudLastPolls = 0;
+
+STATIC
+CHAR16
+mHudText[UI_HUD_TEXT_LENGTH];
+
+STATIC
+AREA_RECT
+mHudPlace;
+
 STATIC
 UINT64
 mDoubleClickTime = 500;
@@ -65,6 +129,30 @@ STATIC
 INTN
 mScreenHeight;
 
+STATIC
+NDK_UI_IMAGE *
+mSceneImage = NULL;
+
+STATIC
+AREA_RECT
+mDamage[UI_DAMAGE_MAX];
+
+STATIC
+UINTN
+mDamageCount = 0;
+
+STATIC
+BOOLEAN
+mFrameOpen = FALSE;
+
+STATIC
+BOOLEAN
+mPointerVisible = FALSE;
+
+STATIC
+BOOLEAN
+mPointerDirty = FALSE;
+
 STATIC
 INTN
 mFontWidth = 8;
@@ -107,25 +195,45 @@ BOOLEAN
 mDarkMode = TRUE;
 
 STATIC
-NDK_UI_IMAGE *
-mBackgroundImage = NULL;
+NDK_UI_TILED_IMAGE *
+mBackground = NULL;
 
 STATIC
-NDK_UI_IMAGE *
-mMenuImage = NULL;
+NDK_UI_ATLAS *
+mIconAtlas = NULL;
+
+STATIC
+AREA_RECT
+mIconRects[OC_INPUT_MAX];
 
 STATIC
 NDK_UI_ICON
-mIconReset = {0, 0, FALSE, NULL, NULL, NULL};
+mIconReset = {0, 0, FALSE, NULL, NULL, NULL, {NULL}};
 
 STATIC
 NDK_UI_ICON
-mIconShutdown = {0, 0, FALSE, NULL, NULL, NULL};
+mIconShutdown = {0, 0, FALSE, NULL, NULL, NULL, {NULL}};
 
 STATIC
 NDK_UI_IMAGE *
 mSelectionImage = NULL;
 
+STATIC
+NDK_UI_MIP_CHAIN
+mSelectionMips;
+
+STATIC
+NDK_UI_IMAGE *
+mScaledSelectionImage = NULL;
+
+STATIC
+NDK_UI_IMAGE *
+mIconTiles[OC_INPUT_MAX][UiTileMax];
+
+STATIC
+UINTN
+mIconTilesTopRow = 0;
+
 STATIC
 NDK_UI_IMAGE *
 mLabelImage = NULL;
@@ -182,55 +290,72 @@ FileExist (
   return FALSE;
 }
 
-VOID
-DrawImageArea (
-  IN NDK_UI_IMAGE      *Image,
-  IN INTN              AreaXpos,
-  IN INTN              AreaYpos,
-  IN INTN              AreaWidth,
-  IN INTN              AreaHeight,
-  IN INTN              ScreenXpos,
-  IN INTN              ScreenYpos
+STATIC
+EFI_STATUS
+GetFileStamp (
+  IN  CONST CHAR16                 *FilePath,
+  OUT NDK_UI_FILE_STAMP            *Stamp
   )
 {
-  EFI_STATUS           Status;
-  
-  if (Image == NULL) {
-    return;
-  }
+  EFI_STATUS                       Status;
+  EFI_FILE_HANDLE                  Volume;
+  EFI_FILE_PROTOCOL                *File;
+  UINT32                           Size;
   
-  if (ScreenXpos < 0 || ScreenXpos >= mScreenWidth || ScreenYpos < 0 || ScreenYpos >= mScreenHeight) {
-    DEBUG ((DEBUG_INFO, "OCUI: Invalid Screen coordinate requested...x:%d - y:%d \n", ScreenXpos, ScreenYpos));
-    return;
+  ZeroMem (Stamp, sizeof (*Stamp));
+  if (mFileSystem == NULL) {
+    return EFI_NOT_FOUND;
   }
   
-  if (AreaWidth == 0) {
-    AreaWidth = Image->Width;
+  Status = mFileSystem->OpenVolume (mFileSystem, &Volume);
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_FOUND;
   }
   
-  if (AreaHeight == 0) {
-    AreaHeight = Image->Height;
+  Status = SafeFileOpen (Volume, &File, (CHAR16 *) FilePath, EFI_FILE_MODE_READ, 0);
+  Volume->Close (Volume);
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_FOUND;
   }
   
-  if ((AreaXpos != 0) || (AreaYpos != 0)) {
-    RestrictImageArea (Image, AreaXpos, AreaYpos, &AreaWidth, &AreaHeight);
-    if (AreaWidth == 0) {
-      DEBUG ((DEBUG_INFO, "OCUI: invalid area position requested\n"));
-      return;
-    }
+  Status = GetFileSize (File, &Size);
+  if (!EFI_ERROR (Status)) {
+    Stamp->Size = Size;
+    Status = GetFileModificationTime (File, &Stamp->Time);
   }
+  File->Close (File);
   
-  if (ScreenXpos + AreaWidth > mScreenWidth) {
-    AreaWidth = mScreenWidth - ScreenXpos;
-  }
+  //
+  // A file without a usable stamp still exists, it is just never cached.
+  //
+  return EFI_ERROR (Status) ? EFI_UNSUPPORTED : EFI_SUCCESS;
+}
+
+STATIC
+VOID
+BltScreenArea (
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Buffer,
+  IN UINTN                         BufferWidth,
+  IN INTN                          AreaXpos,
+  IN INTN                          AreaYpos,
+  IN INTN                          ScreenXpos,
+  IN INTN                          ScreenYpos,
+  IN INTN                          AreaWidth,
+  IN INTN                          AreaHeight
+  )
+{
+  EFI_STATUS                       Status;
+  UINT64                           Start;
   
-  if (ScreenYpos + AreaHeight > mScreenHeight) {
-    AreaHeight = mScreenHeight - ScreenYpos;
+  Start = GopBltBegin ();
+  if (FrameBufferBlt (Buffer, BufferWidth, AreaXpos, AreaYpos, ScreenXpos, ScreenYpos, AreaWidth, AreaHeight)) {
+    GopBltEnd (Start, AreaWidth * AreaHeight, 0);
+    return;
   }
   
   if (mGraphicsOutput != NULL) {
     Status = mGraphicsOutput->Blt(mGraphicsOutput,
-                                  Image->Bitmap,
+                                  Buffer,
                                   EfiBltBufferToVideo,
                                   (UINTN) AreaXpos,
                                   (UINTN) AreaYpos,
@@ -238,12 +363,12 @@ DrawImageArea (
                                   (UINTN) ScreenYpos,
                                   (UINTN) AreaWidth,
                                   (UINTN) AreaHeight,
-                                  (UINTN) Image->Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                                  BufferWidth * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
                                   );
   } else {
     ASSERT (mUgaDraw != NULL);
     Status = mUgaDraw->Blt(mUgaDraw,
-                            (EFI_UGA_PIXEL *) Image->Bitmap,
+                            (EFI_UGA_PIXEL *) Buffer,
                             EfiUgaBltBufferToVideo,
                             (UINTN) AreaXpos,
                             (UINTN) AreaYpos,
@@ -251,249 +376,1159 @@ DrawImageArea (
                             (UINTN) ScreenYpos,
                             (UINTN) AreaWidth,
                             (UINTN) AreaHeight,
-                            (UINTN) Image->Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                            BufferWidth * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
                             );
   }
+  GopBltEnd (Start, AreaWidth * AreaHeight, 0);
   
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_INFO, "OCUI: Draw Image Area...%r\n", Status));
   }
 }
 
+STATIC
+BOOLEAN
+IsRectOverlapping (
+  IN AREA_RECT         *Rect,
+  IN AREA_RECT         *Other
+  )
+{
+  return Rect->Xpos < Other->Xpos + Other->Width
+    && Other->Xpos < Rect->Xpos + Rect->Width
+    && Rect->Ypos < Other->Ypos + Other->Height
+    && Other->Ypos < Rect->Ypos + Rect->Height;
+}
+
 STATIC
 VOID
-TakeImage (
-  IN NDK_UI_IMAGE      *Image,
-  IN INTN              ScreenXpos,
-  IN INTN              ScreenYpos,
-  IN INTN              AreaWidth,
-  IN INTN              AreaHeight
+UnionRect (
+  IN OUT AREA_RECT     *Rect,
+  IN     AREA_RECT     *Other
   )
 {
-  EFI_STATUS           Status;
+  INTN                 Right;
+  INTN                 Bottom;
+  
+  Right = MAX (Rect->Xpos + Rect->Width, Other->Xpos + Other->Width);
+  Bottom = MAX (Rect->Ypos + Rect->Height, Other->Ypos + Other->Height);
+  Rect->Xpos = MIN (Rect->Xpos, Other->Xpos);
+  Rect->Ypos = MIN (Rect->Ypos, Other->Ypos);
+  Rect->Width = Right - Rect->Xpos;
+  Rect->Height = Bottom - Rect->Ypos;
+}
+
+STATIC
+BOOLEAN
+MergeDamage (
+  IN OUT AREA_RECT     *Rect,
+  IN     AREA_RECT     *Other
+  )
+{
+  AREA_RECT            Union;
   
-  if (ScreenXpos + AreaWidth > mScreenWidth) {
-    AreaWidth = mScreenWidth - ScreenXpos;
+  //
+  // Two areas are sent as one when that costs no more pixels than sending them apart.
+  //
+  Union = *Rect;
+  UnionRect (&Union, Other);
+  if (Union.Width * Union.Height > Rect->Width * Rect->Height + Other->Width * Other->Height) {
+    return FALSE;
   }
   
-  if (ScreenYpos + AreaHeight > mScreenHeight) {
-    AreaHeight = mScreenHeight - ScreenYpos;
-  }
-    
-  if (mGraphicsOutput != NULL) {
-    Status = mGraphicsOutput->Blt(mGraphicsOutput,
-                                  (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) Image->Bitmap,
-                                  EfiBltVideoToBltBuffer,
-                                  ScreenXpos,
-                                  ScreenYpos,
-                                  0,
-                                  0,
-                                  AreaWidth,
-                                  AreaHeight,
-                                  (UINTN) Image->Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
-                                  );
-  } else {
-    ASSERT (mUgaDraw != NULL);
-    Status = mUgaDraw->Blt(mUgaDraw,
-                           (EFI_UGA_PIXEL *) Image->Bitmap,
-                           EfiUgaVideoToBltBuffer,
-                           ScreenXpos,
-                           ScreenYpos,
-                           0,
-                           0,
-                           AreaWidth,
-                           AreaHeight,
-                           (UINTN) Image->Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
-                           );
-  }
+  *Rect = Union;
+  return TRUE;
 }
 
 STATIC
 VOID
-CreateMenuImage (
-  IN NDK_UI_IMAGE        *Icon,
-  IN UINTN               IconCount
+AddDamage (
+  IN INTN              Xpos,
+  IN INTN              Ypos,
+  IN INTN              Width,
+  IN INTN              Height
   )
 {
-  NDK_UI_IMAGE           *NewImage;
-  UINT16                 Width;
-  UINT16                 Height;
-  BOOLEAN                IsTwoRow;
-  UINTN                  IconsPerRow;
-  INTN                   Xpos;
-  INTN                   Ypos;
-  INTN                   Offset;
-  INTN                   IconRowSpace;
-  
-  NewImage = NULL;
-  Xpos = 0;
-  Ypos = 0;
-  IconRowSpace = (32 * mUiScale >> 4) + ICON_ROW_SPACE_OFFSET;
+  AREA_RECT            Rect;
+  AREA_RECT            Union;
+  UINTN                Index;
+  UINTN                Best;
+  INTN                 Growth;
+  INTN                 BestGrowth;
   
-  if (mMenuImage != NULL) {
-    Width = mMenuImage->Width;
-    Height = mMenuImage->Height;
-    IsTwoRow = mMenuImage->Height > mIconSpaceSize + IconRowSpace;
-    
-    if (IsTwoRow) {
-      IconsPerRow = mMenuImage->Width / mIconSpaceSize;
-      Xpos = (IconCount - IconsPerRow) * mIconSpaceSize;
-      Ypos = mIconSpaceSize + IconRowSpace;
-    } else {
-      if (mMenuImage->Width + (mIconSpaceSize * 2) <= mScreenWidth) {
-        Width = mMenuImage->Width + mIconSpaceSize;
-        Xpos = mMenuImage->Width;
-      } else {
-        Height = mMenuImage->Height + mIconSpaceSize + IconRowSpace;
-        Ypos = mIconSpaceSize + IconRowSpace;
-      }
-    }
-  } else {
-    Width = mIconSpaceSize;
-    Height = Width;
+  if (Xpos < 0) {
+    Width += Xpos;
+    Xpos = 0;
   }
-  
-  NewImage = CreateFilledImage (Width, Height, TRUE, &mTransparentPixel);
-  if (NewImage == NULL) {
+  if (Ypos < 0) {
+    Height += Ypos;
+    Ypos = 0;
+  }
+  Width = MIN (Width, mScreenWidth - Xpos);
+  Height = MIN (Height, mScreenHeight - Ypos);
+  if (Width <= 0 || Height <= 0) {
     return;
   }
   
-  if (mMenuImage != NULL) {
-    ComposeImage (NewImage, mMenuImage, 0, 0);
-    if (mMenuImage != NULL) {
-      FreeImage (mMenuImage);
+  Rect.Xpos = Xpos;
+  Rect.Ypos = Ypos;
+  Rect.Width = Width;
+  Rect.Height = Height;
+  
+  Best = 0;
+  BestGrowth = MAX_INTN;
+  for (Index = 0; Index < mDamageCount; ++Index) {
+    if (MergeDamage (&mDamage[Index], &Rect)) {
+      return;
+    }
+    Union = mDamage[Index];
+    UnionRect (&Union, &Rect);
+    Growth = Union.Width * Union.Height - mDamage[Index].Width * mDamage[Index].Height;
+    if (Growth < BestGrowth) {
+      BestGrowth = Growth;
+      Best = Index;
     }
   }
   
-  Offset = (mIconSpaceSize - (Icon->Width + (mIconPaddingSize * 2))) > 0 ? (mIconSpaceSize - (Icon->Width + (mIconPaddingSize * 2))) / 2 : 0;
-  
-  ComposeImage (NewImage, Icon, Xpos + mIconPaddingSize + Offset, Ypos + mIconPaddingSize + Offset);
-  if (Icon != NULL) {
-    FreeImage (Icon);
+  if (mDamageCount < UI_DAMAGE_MAX) {
+    mDamage[mDamageCount++] = Rect;
+  } else {
+    UnionRect (&mDamage[Best], &Rect);
   }
-  
-  mMenuImage = NewImage;
 }
 
 STATIC
 VOID
-BltImageAlpha (
-  IN NDK_UI_IMAGE                  *Image,
-  IN INTN                          Xpos,
-  IN INTN                          Ypos,
-  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackgroundPixel,
-  IN INTN                          Scale
+PresentScene (
+  VOID
   )
 {
-  NDK_UI_IMAGE        *CompImage;
-  NDK_UI_IMAGE        *NewImage;
-  INTN                Width;
-  INTN                Height;
+  UINTN                Index;
+  UINTN                Other;
+  AREA_RECT            PointerPlace;
+  BOOLEAN              PointerDamaged;
   
-  NewImage = NULL;
-  Width    = Scale << 3;
-  Height   = Width;
-
-  if (Image != NULL) {
-    NewImage = CopyScaledImage (Image, Scale);
-    Width = NewImage->Width;
-    Height = NewImage->Height;
+  if (mSceneImage == NULL) {
+    return;
   }
-
-  CompImage = CreateFilledImage (Width, Height, (mBackgroundImage != NULL), BackgroundPixel);
-  ComposeImage (CompImage, NewImage, 0, 0);
-  if (NewImage != NULL) {
-    FreeImage (NewImage);
+  
+  for (Index = 0; Index < mDamageCount; ++Index) {
+    for (Other = Index + 1; Other < mDamageCount;) {
+      if (MergeDamage (&mDamage[Index], &mDamage[Other])) {
+        mDamage[Other] = mDamage[--mDamageCount];
+        Other = Index + 1;
+      } else {
+        ++Other;
+      }
+    }
   }
-  if (mBackgroundImage == NULL) {
-    DrawImageArea (CompImage, 0, 0, 0, 0, Xpos, Ypos);
-    FreeImage (CompImage);
-    return;
+  
+  PointerPlace.Xpos = mPointer.OldPlace.Xpos;
+  PointerPlace.Ypos = mPointer.OldPlace.Ypos;
+  PointerPlace.Width = MIN (POINTER_WIDTH, mScreenWidth - PointerPlace.Xpos);
+  PointerPlace.Height = MIN (POINTER_HEIGHT, mScreenHeight - PointerPlace.Ypos);
+  PointerDamaged = mPointerDirty;
+  
+  for (Index = 0; Index < mDamageCount; ++Index) {
+    BltScreenArea (mSceneImage->Bitmap,
+                   mSceneImage->Width,
+                   mDamage[Index].Xpos,
+                   mDamage[Index].Ypos,
+                   mDamage[Index].Xpos,
+                   mDamage[Index].Ypos,
+                   mDamage[Index].Width,
+                   mDamage[Index].Height
+                   );
+    PointerDamaged |= IsRectOverlapping (&mDamage[Index], &PointerPlace);
   }
   
-  // Background Image was used.
-  NewImage = CreateImage (Width, Height, FALSE);
-  if (NewImage == NULL) {
-    return;
+  //
+  // The pointer is not part of the scene, it is composed over it after the damaged areas are sent.
+  //
+  if (mPointerVisible && PointerDamaged && mPointer.NewImage != NULL) {
+    RawCopy (mPointer.NewImage->Bitmap,
+             mSceneImage->Bitmap + PointerPlace.Ypos * mSceneImage->Width + PointerPlace.Xpos,
+             PointerPlace.Width,
+             PointerPlace.Height,
+             mPointer.NewImage->Width,
+             mSceneImage->Width
+             );
+    RawCompose (mPointer.NewImage->Bitmap,
+                mPointer.IsClickable ? mPointer.PointerAlt->Bitmap : mPointer.Pointer->Bitmap,
+                PointerPlace.Width,
+                PointerPlace.Height,
+                mPointer.NewImage->Width,
+                mPointer.Pointer->Width
+                );
+    BltScreenArea (mPointer.NewImage->Bitmap,
+                   mPointer.NewImage->Width,
+                   0,
+                   0,
+                   PointerPlace.Xpos,
+                   PointerPlace.Ypos,
+                   PointerPlace.Width,
+                   PointerPlace.Height
+                   );
   }
-  RawCopy (NewImage->Bitmap,
-           mBackgroundImage->Bitmap + Ypos * mBackgroundImage->Width + Xpos,
-           Width,
-           Height,
-           Width,
-           mBackgroundImage->Width
-           );
-  // Compose
-  ComposeImage (NewImage, CompImage, 0, 0);
-  FreeImage (CompImage);
-  // Draw to screen
-  DrawImageArea (NewImage, 0, 0, 0, 0, Xpos, Ypos);
-  FreeImage (NewImage);
+  
+  mDamageCount = 0;
+  mPointerDirty = FALSE;
 }
 
 STATIC
-VOID
-BltMenuImage (
-  IN NDK_UI_IMAGE        *Image,
-  IN INTN                Xpos,
-  IN INTN                Ypos
+EFI_STATUS
+SaveEspFile (
+  IN CHAR16              *Path,
+  IN VOID                *Buffer,
+  IN UINTN               BufferSize
   )
 {
-  NDK_UI_IMAGE           *NewImage;
+  EFI_STATUS              Status;
+  EFI_FILE_PROTOCOL       *Fs;
   
-  if (Image == NULL) {
-    return;
+  if (mFileSystem == NULL) {
+    return EFI_NOT_FOUND;
   }
   
-  NewImage = CreateImage (Image->Width, Image->Height, FALSE);
+  Status = mFileSystem->OpenVolume (mFileSystem, &Fs);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_INFO, "OCUI: Locating Writeable file system - %r\n", Status));
+    return Status;
+  }
+  
+  return SetFileData (Fs, Path, Buffer, (UINT32) BufferSize);
+}
+
+//
+// Image is converted to RGBA in place.
+//
+STATIC
+EFI_STATUS
+SavePngFile (
+  IN NDK_UI_IMAGE        *Image,
+  IN CHAR16              *Path
+  )
+{
+  EFI_STATUS              Status;
+  EFI_UGA_PIXEL           *ImagePNG;
+  VOID                    *Buffer;
+  UINTN                   BufferSize;
+  UINTN                   Index;
+  UINTN                   ImageSize;
+  UINT8                   Temp;
+  
+  Buffer     = NULL;
+  BufferSize = 0;
+  
+  ImagePNG = (EFI_UGA_PIXEL *) Image->Bitmap;
+  ImageSize = Image->Width * Image->Height;
+  
+  // Convert BGR to RGBA with Alpha set to 0xFF
+  for (Index = 0; Index < ImageSize; ++Index) {
+      Temp = ImagePNG[Index].Blue;
+      ImagePNG[Index].Blue = ImagePNG[Index].Red;
+      ImagePNG[Index].Red = Temp;
+      ImagePNG[Index].Reserved = 0xFF;
+  }
+
+  // Encode raw RGB image to PNG format
+  Status = EncodePng (ImagePNG,
+                      (UINTN) Image->Width,
+                      (UINTN) Image->Height,
+                      &Buffer,
+                      &BufferSize
+                      );
+  if (Buffer == NULL) {
+    DEBUG ((DEBUG_INFO, "OCUI: Fail Encoding!\n"));
+    return EFI_ERROR (Status) ? Status : EFI_OUT_OF_RESOURCES;
+  }
+  
+  Status = SaveEspFile (Path, Buffer, BufferSize);
+  FreePool (Buffer);
+  
+  return Status;
+}
+
+STATIC
+VOID
+DumpVirtualFrame (
+  VOID
+  )
+{
+  EFI_STATUS              Status;
+  NDK_UI_VIRTUAL_STATS    *Stats;
+  NDK_UI_IMAGE            *Image;
+  CHAR16                  Path[32];
+  
+  Stats = GetVirtualDisplayStats ();
+  if (Stats->FramesDumped >= Stats->DumpFrames) {
+    return;
+  }
+  
+  Image = CreateImage (mScreenWidth, mScreenHeight, FALSE);
+  if (Image == NULL) {
+    return;
+  }
+  
+  CaptureVirtualDisplay (Image);
+  UnicodeSPrint (Path, sizeof (Path), L"VirtualFrame-%04u.png", Stats->FramesDumped);
+  Status = SavePngFile (Image, Path);
+  FreeImage (Image);
+  
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_INFO, "OCUI: Frame dump failed - %r\n", Status));
+    Stats->DumpFrames = Stats->FramesDumped;
+    return;
+  }
+  
+  ++Stats->FramesDumped;
+}
+
+STATIC
+VOID
+SaveGopStats (
+  VOID
+  )
+{
+  CHAR8                   *Report;
+  UINTN                   ReportSize;
+  
+  Report = GopStatsReport (&ReportSize);
+  if (Report == NULL) {
+    return;
+  }
+  
+  DEBUG ((DEBUG_INFO, "OCUI: GOP statistics saved - %r\n", SaveEspFile (UI_GOP_STATS_FILE, Report, ReportSize)));
+  FreePool (Report);
+}
+
+STATIC
+VOID
+SaveTimeline (
+  VOID
+  )
+{
+  CHAR8                   *Report;
+  UINTN                   ReportSize;
+  
+  Report = TimelineReport (&ReportSize);
+  if (Report == NULL) {
+    return;
+  }
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Timeline saved - %r\n", SaveEspFile (UI_TIMELINE_FILE, Report, ReportSize)));
+  FreePool (Report);
+}
+
+STATIC
+VOID
+SaveLatency (
+  VOID
+  )
+{
+  CHAR8                   *Report;
+  UINTN                   ReportSize;
+  
+  Report = LatencyReport (&ReportSize);
+  if (Report == NULL) {
+    return;
+  }
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Latency saved - %r\n", SaveEspFile (UI_LATENCY_FILE, Report, ReportSize)));
+  FreePool (Report);
+}
+
+STATIC
+VOID
+SaveProfile (
+  VOID
+  )
+{
+#ifndef MDEPKG_NDEBUG
+  CHAR8                   *Report;
+  UINTN                   ReportSize;
+  
+  Report = ProfileReport (&ReportSize);
+  if (Report == NULL) {
+    return;
+  }
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Profile saved - %r\n", SaveEspFile (UI_PROFILE_FILE, Report, ReportSize)));
+  FreePool (Report);
+#endif
+}
+
+STATIC
+VOID
+SaveAllocations (
+  VOID
+  )
+{
+  CHAR8                   *Report;
+  UINTN                   ReportSize;
+  
+  Report = AllocationReport (&ReportSize);
+  if (Report == NULL) {
+    return;
+  }
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Allocations saved - %r\n", SaveEspFile (UI_ALLOC_TRACK_FILE, Report, ReportSize)));
+  FreePool (Report);
+}
+
+BOOLEAN
+UiBeginFrame (
+  VOID
+  )
+{
+  if (mFrameOpen) {
+    return FALSE;
+  }
+  
+  mFrameOpen = TRUE;
+  GopBeginFrame ();
+  return TRUE;
+}
+
+VOID
+UiEndFrame (
+  VOID
+  )
+{
+  BOOLEAN              Presented;
+  NDK_UI_GOP_CALLER    Caller;
+  
+  mFrameOpen = FALSE;
+  Presented = mDamageCount != 0 || (mPointerVisible && mPointerDirty);
+  Caller = GopEnterCaller (UiGopPresent);
+  PresentScene ();
+  GopLeaveCaller (Caller);
+  GopEndFrame ();
+  LatencyEnd (GetGopLastBltTicks ());
+  
+  if (Presented && IsVirtualDisplay (mGraphicsOutput)) {
+    DumpVirtualFrame ();
+  }
+}
+
+VOID
+DrawImageArea (
+  IN NDK_UI_IMAGE      *Image,
+  IN INTN              AreaXpos,
+  IN INTN              AreaYpos,
+  IN INTN              AreaWidth,
+  IN INTN              AreaHeight,
+  IN INTN              ScreenXpos,
+  IN INTN              ScreenYpos
+  )
+{
+  if (Image == NULL) {
+    return;
+  }
+  
+  UI_PROFILE_BEGIN (UiProfileDrawImageArea);
+  if (ScreenXpos < 0 || ScreenXpos >= mScreenWidth || ScreenYpos < 0 || ScreenYpos >= mScreenHeight) {
+    DEBUG ((DEBUG_INFO, "OCUI: Invalid Screen coordinate requested...x:%d - y:%d \n", ScreenXpos, ScreenYpos));
+    UI_PROFILE_END (UiProfileDrawImageArea);
+    return;
+  }
+  
+  if (AreaWidth == 0) {
+    AreaWidth = Image->Width;
+  }
+  
+  if (AreaHeight == 0) {
+    AreaHeight = Image->Height;
+  }
+  
+  if ((AreaXpos != 0) || (AreaYpos != 0)) {
+    RestrictImageArea (Image, AreaXpos, AreaYpos, &AreaWidth, &AreaHeight);
+    if (AreaWidth == 0) {
+      DEBUG ((DEBUG_INFO, "OCUI: invalid area position requested\n"));
+      UI_PROFILE_END (UiProfileDrawImageArea);
+      return;
+    }
+  }
+  
+  if (ScreenXpos + AreaWidth > mScreenWidth) {
+    AreaWidth = mScreenWidth - ScreenXpos;
+  }
+  
+  if (ScreenYpos + AreaHeight > mScreenHeight) {
+    AreaHeight = mScreenHeight - ScreenYpos;
+  }
+  
+  GopCountDraw (AreaWidth * AreaHeight);
+  
+  if (mSceneImage != NULL) {
+    RawCopy (mSceneImage->Bitmap + ScreenYpos * mSceneImage->Width + ScreenXpos,
+             Image->Bitmap + AreaYpos * Image->Width + AreaXpos,
+             AreaWidth,
+             AreaHeight,
+             mSceneImage->Width,
+             Image->Width
+             );
+    AddDamage (ScreenXpos, ScreenYpos, AreaWidth, AreaHeight);
+    if (!mFrameOpen) {
+      PresentScene ();
+    }
+    UI_PROFILE_END (UiProfileDrawImageArea);
+    return;
+  }
+  
+  BltScreenArea (Image->Bitmap,
+                 Image->Width,
+                 AreaXpos,
+                 AreaYpos,
+                 ScreenXpos,
+                 ScreenYpos,
+                 AreaWidth,
+                 AreaHeight
+                 );
+  UI_PROFILE_END (UiProfileDrawImageArea);
+}
+
+STATIC
+VOID
+DrawComposedArea (
+  IN NDK_UI_IMAGE                  *Image OPTIONAL,
+  IN INTN                          Ratio,
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Fill OPTIONAL,
+  IN INTN                          Xpos,
+  IN INTN                          Ypos,
+  IN INTN                          Width,
+  IN INTN                          Height
+  )
+{
+  NDK_UI_IMAGE                     *Target;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *DestPtr;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL    OpaqueFill;
+  INTN                             LineOffset;
+  
+  if (Xpos < 0 || Xpos >= mScreenWidth || Ypos < 0 || Ypos >= mScreenHeight) {
+    DEBUG ((DEBUG_INFO, "OCUI: Invalid Screen coordinate requested...x:%d - y:%d \n", Xpos, Ypos));
+    return;
+  }
+  
+  Width = MIN (Width, mScreenWidth - Xpos);
+  Height = MIN (Height, mScreenHeight - Ypos);
+  if (Width <= 0 || Height <= 0) {
+    return;
+  }
+  
+  //
+  // Without a background image the fill colour is the background, whatever its alpha.
+  //
+  if (mBackground == NULL) {
+    OpaqueFill = (Fill != NULL) ? *Fill : mBlackPixel;
+    OpaqueFill.Reserved = 0xFF;
+    Fill = &OpaqueFill;
+  }
+  
+  //
+  // The scene is the output buffer, the only scratch image is the one used when there is no scene.
+  //
+  Target = NULL;
+  if (mSceneImage != NULL) {
+    DestPtr = mSceneImage->Bitmap + Ypos * mSceneImage->Width + Xpos;
+    LineOffset = mSceneImage->Width;
+  } else {
+    Target = CreateImage ((UINT16) Width, (UINT16) Height, FALSE);
+    if (Target == NULL) {
+      return;
+    }
+    DestPtr = Target->Bitmap;
+    LineOffset = Width;
+  }
+  
+  if (mBackground != NULL) {
+    CopyTiledImageArea (mBackground, Xpos, Ypos, Width, Height, DestPtr, LineOffset);
+  }
+  ScaleComposeArea (DestPtr, LineOffset, Fill, Image, Ratio, Width, Height);
+  
+  if (Target != NULL) {
+    DrawImageArea (Target, 0, 0, 0, 0, Xpos, Ypos);
+    FreeImage (Target);
+    return;
+  }
+  
+  GopCountDraw (Width * Height);
+  AddDamage (Xpos, Ypos, Width, Height);
+  if (!mFrameOpen) {
+    PresentScene ();
+  }
+}
+
+STATIC
+VOID
+TakeImage (
+  IN NDK_UI_IMAGE      *Image,
+  IN INTN              ScreenXpos,
+  IN INTN              ScreenYpos,
+  IN INTN              AreaWidth,
+  IN INTN              AreaHeight
+  )
+{
+  EFI_STATUS           Status;
+  UINT64               Start;
+  
+  if (ScreenXpos + AreaWidth > mScreenWidth) {
+    AreaWidth = mScreenWidth - ScreenXpos;
+  }
+  
+  if (ScreenYpos + AreaHeight > mScreenHeight) {
+    AreaHeight = mScreenHeight - ScreenYpos;
+  }
+  
+  GopCountTake (AreaWidth * AreaHeight);
+  
+  //
+  // The scene mirrors video, so read backs never have to touch the frame buffer.
+  //
+  if (mSceneImage != NULL) {
+    RawCopy (Image->Bitmap,
+             mSceneImage->Bitmap + ScreenYpos * mSceneImage->Width + ScreenXpos,
+             AreaWidth,
+             AreaHeight,
+             Image->Width,
+             mSceneImage->Width
+             );
+    return;
+  }
+  
+  Start = GopBltBegin ();
+  if (mGraphicsOutput != NULL) {
+    Status = mGraphicsOutput->Blt(mGraphicsOutput,
+                                  (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) Image->Bitmap,
+                                  EfiBltVideoToBltBuffer,
+                                  ScreenXpos,
+                                  ScreenYpos,
+                                  0,
+                                  0,
+                                  AreaWidth,
+                                  AreaHeight,
+                                  (UINTN) Image->Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                                  );
+  } else {
+    ASSERT (mUgaDraw != NULL);
+    Status = mUgaDraw->Blt(mUgaDraw,
+                           (EFI_UGA_PIXEL *) Image->Bitmap,
+                           EfiUgaVideoToBltBuffer,
+                           ScreenXpos,
+                           ScreenYpos,
+                           0,
+                           0,
+                           AreaWidth,
+                           AreaHeight,
+                           (UINTN) Image->Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                           );
+  }
+  GopBltEnd (Start, 0, AreaWidth * AreaHeight);
+}
+
+STATIC
+EFI_STATUS
+MoveScreenArea (
+  IN INTN              SourceXpos,
+  IN INTN              SourceYpos,
+  IN INTN              ScreenXpos,
+  IN INTN              ScreenYpos,
+  IN INTN              AreaWidth,
+  IN INTN              AreaHeight
+  )
+{
+  EFI_STATUS           Status;
+  INTN                 Row;
+  UINT64               Start;
+  
+  if (SourceXpos < 0 || SourceYpos < 0 || ScreenXpos < 0 || ScreenYpos < 0
+      || SourceXpos + AreaWidth > mScreenWidth || SourceYpos + AreaHeight > mScreenHeight
+      || ScreenXpos + AreaWidth > mScreenWidth || ScreenYpos + AreaHeight > mScreenHeight) {
+    return EFI_INVALID_PARAMETER;
+  }
+  
+  PresentScene ();
+  
+  if (mSceneImage != NULL) {
+    if (ScreenYpos <= SourceYpos) {
+      for (Row = 0; Row < AreaHeight; ++Row) {
+        CopyMem (mSceneImage->Bitmap + (ScreenYpos + Row) * mSceneImage->Width + ScreenXpos,
+                 mSceneImage->Bitmap + (SourceYpos + Row) * mSceneImage->Width + SourceXpos,
+                 AreaWidth * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                 );
+      }
+    } else {
+      for (Row = AreaHeight - 1; Row >= 0; --Row) {
+        CopyMem (mSceneImage->Bitmap + (ScreenYpos + Row) * mSceneImage->Width + ScreenXpos,
+                 mSceneImage->Bitmap + (SourceYpos + Row) * mSceneImage->Width + SourceXpos,
+                 AreaWidth * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                 );
+      }
+    }
+    
+    //
+    // Reading the frame buffer back is slow, so the moved area is written again from the scene.
+    //
+    if (IsFrameBufferActive ()) {
+      AddDamage (ScreenXpos, ScreenYpos, AreaWidth, AreaHeight);
+      if (!mFrameOpen) {
+        PresentScene ();
+      }
+      return EFI_SUCCESS;
+    }
+  }
+  
+  Start = GopBltBegin ();
+  if (mGraphicsOutput != NULL) {
+    Status = mGraphicsOutput->Blt(mGraphicsOutput,
+                                NULL,
+                                EfiBltVideoToVideo,
+                                (UINTN) SourceXpos,
+                                (UINTN) SourceYpos,
+                                (UINTN) ScreenXpos,
+                                (UINTN) ScreenYpos,
+                                (UINTN) AreaWidth,
+                                (UINTN) AreaHeight,
+                                0
+                                );
+  } else {
+    ASSERT (mUgaDraw != NULL);
+    Status = mUgaDraw->Blt(mUgaDraw,
+                           NULL,
+                           EfiUgaVideoToVideo,
+                           (UINTN) SourceXpos,
+                           (UINTN) SourceYpos,
+                           (UINTN) ScreenXpos,
+                           (UINTN) ScreenYpos,
+                           (UINTN) AreaWidth,
+                           (UINTN) AreaHeight,
+                           0
+                           );
+  }
+  GopBltEnd (Start, AreaWidth * AreaHeight, AreaWidth * AreaHeight);
+  
+  return Status;
+}
+
+STATIC
+VOID
+SetMenuLayout (
+  IN UINTN               IconCount
+  )
+{
+  //
+  // First row keeps growing while one more icon plus two icon spaces of margin fit on screen,
+  // the grid then continues row by row and only UI_MENU_VISIBLE_ROWS rows are shown at once.
+  //
+  for (mIconsPerRow = 1; mIconsPerRow < IconCount; ++mIconsPerRow) {
+    if ((mIconsPerRow + 2) * mIconSpaceSize > mScreenWidth) {
+      break;
+    }
+  }
+  
+  mMenuRows = (IconCount + mIconsPerRow - 1) / mIconsPerRow;
+  mMenuTopRow = 0;
+}
+
+STATIC
+BOOLEAN
+GetIconPosition (
+  IN  UINTN              IconIndex,
+  OUT INTN               *Xpos,
+  OUT INTN               *Ypos
+  )
+{
+  UINTN                  Row;
+  INTN                   IconRowSpace;
+  
+  if (mIconAtlas == NULL || mIconsPerRow == 0) {
+    return FALSE;
+  }
+  
+  Row = IconIndex / mIconsPerRow;
+  if (Row < mMenuTopRow || Row >= mMenuTopRow + UI_MENU_VISIBLE_ROWS) {
+    return FALSE;
+  }
+  
+  IconRowSpace = (32 * mUiScale >> 4) + ICON_ROW_SPACE_OFFSET;
+  *Xpos = (mScreenWidth - (INTN) (mIconsPerRow * mIconSpaceSize)) / 2 + (INTN) ((IconIndex % mIconsPerRow) * mIconSpaceSize);
+  *Ypos = (mScreenHeight / 2) - (INTN) mIconSpaceSize + (INTN) (Row - mMenuTopRow) * ((INTN) mIconSpaceSize + IconRowSpace);
+  
+  return TRUE;
+}
+
+STATIC
+VOID
+DrawMenuRow (
+  IN UINTN               IconCount,
+  IN UINTN               Row
+  )
+{
+  NDK_UI_IMAGE           *NewImage;
+  AREA_RECT              *Rect;
+  UINTN                  Index;
+  INTN                   Xpos;
+  INTN                   Ypos;
+  INTN                   Offset;
+  
+  if (Row * mIconsPerRow >= IconCount || !GetIconPosition (Row * mIconsPerRow, &Xpos, &Ypos)) {
+    return;
+  }
+  
+  NewImage = CreateImage ((UINT16) (mIconsPerRow * mIconSpaceSize), (UINT16) mIconSpaceSize, FALSE);
   if (NewImage == NULL) {
     return;
   }
   
-  RawCopy (NewImage->Bitmap,
-           mBackgroundImage->Bitmap + Ypos * mBackgroundImage->Width + Xpos,
-           Image->Width,
-           Image->Height,
-           Image->Width,
-           mBackgroundImage->Width
-           );
-  
-  RawComposeColor (NewImage->Bitmap,
-                   Image->Bitmap,
-                   NewImage->Width,
-                   NewImage->Height,
-                   NewImage->Width,
-                   Image->Width,
-                   ICON_BRIGHTNESS_FULL
-                   );
-  
-  DrawImageArea (NewImage, 0, 0, 0, 0, Xpos, Ypos);
-  FreeImage (NewImage);
+  CopyTiledImageArea (mBackground,
+                      Xpos,
+                      Ypos,
+                      NewImage->Width,
+                      NewImage->Height,
+                      NewImage->Bitmap,
+                      NewImage->Width
+                      );
+  
+  for (Index = Row * mIconsPerRow; Index < IconCount && Index < (Row + 1) * mIconsPerRow; ++Index) {
+    Rect = &mIconRects[Index];
+    if (Rect->Width == 0) {
+      continue;
+    }
+    
+    Offset = ((INTN) mIconSpaceSize - (Rect->Width + (INTN) (mIconPaddingSize * 2))) > 0 ? ((INTN) mIconSpaceSize - (Rect->Width + (INTN) (mIconPaddingSize * 2))) / 2 : 0;
+    
+    RawComposeColor (NewImage->Bitmap + (mIconPaddingSize + Offset) * NewImage->Width + (Index % mIconsPerRow) * mIconSpaceSize + mIconPaddingSize + Offset,
+                     mIconAtlas->Image.Bitmap + Rect->Ypos * mIconAtlas->Image.Width + Rect->Xpos,
+                     Rect->Width,
+                     Rect->Height,
+                     NewImage->Width,
+                     mIconAtlas->Image.Width,
+                     mMenuColorDiff
+                     );
+  }
+  
+  DrawImageArea (NewImage, 0, 0, 0, 0, Xpos, Ypos);
+  FreeImage (NewImage);
+}
+
+STATIC
+VOID
+BltImageAlpha (
+  IN NDK_UI_IMAGE                  *Image,
+  IN INTN                          Xpos,
+  IN INTN                          Ypos,
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BackgroundPixel,
+  IN INTN                          Scale
+  )
+{
+  INTN                Width;
+  INTN                Height;
+  
+  Width    = Scale << 3;
+  Height   = Width;
+
+  if (Image != NULL) {
+    Width = (Image->Width * Scale) >> 4;
+    Height = (Image->Height * Scale) >> 4;
+  }
+
+  DrawComposedArea (Image, Scale, BackgroundPixel, Xpos, Ypos, Width, Height);
+}
+
+STATIC
+NDK_UI_IMAGE *
+DecodePNGFileOrFallback (
+  IN CONST CHAR16                  *FilePath,
+  IN CONST CHAR16                  *Fallback OPTIONAL
+  )
+{
+  VOID                             *Buffer;
+  UINT32                           BufferSize;
+  UINT32                           Width;
+  UINT32                           Height;
+  UINTN                            Bytes;
+  
+  Buffer = NULL;
+  BufferSize = 0;
+  
+  ASSERT (FilePath != NULL);
+  ASSERT (StrLen (FilePath) > 0);
+  
+  Buffer = ReadFile (mFileSystem, FilePath, &BufferSize, BASE_16MB);
+  
+  if (Buffer == NULL) {
+    DEBUG ((DEBUG_ERROR, "OCUI: Failed to locate %s file\n", FilePath));
+    return Fallback != NULL ? DecodePNGFileOrFallback (Fallback, NULL) : NULL;
+  }
+  
+  //
+  // The header tells the decoded size up front, so the budget is settled before decoding.
+  //
+  if (!EFI_ERROR (GetPngDimensions (Buffer, BufferSize, &Width, &Height))) {
+    Bytes = (UINTN) Width * Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+    if (!ReserveImageBytes (Bytes)) {
+      if (Fallback != NULL && FileExist (Fallback)) {
+        DEBUG ((DEBUG_INFO, "OCUI: Budget %u of %u KB used, %s needs %u KB, using %s\n",
+                (UINT32) (GetImageBytesInUse () / SIZE_1KB),
+                (UINT32) (GetMemoryBudget () / SIZE_1KB),
+                FilePath,
+                (UINT32) (Bytes / SIZE_1KB),
+                Fallback
+                ));
+        FreePool (Buffer);
+        return DecodePNGFileOrFallback (Fallback, NULL);
+      }
+      DEBUG ((DEBUG_INFO, "OCUI: Budget exceeded by %s, %u KB, decoding anyway\n", FilePath, (UINT32) (Bytes / SIZE_1KB)));
+    }
+  }
+  
+  return DecodePNG (Buffer, BufferSize);
+}
+
+STATIC
+NDK_UI_IMAGE *
+DecodePNGFile (
+  IN CONST CHAR16                  *FilePath
+  )
+{
+  return DecodePNGFileOrFallback (FilePath, NULL);
+}
+
+STATIC
+NDK_UI_IMAGE *
+LoadAsset (
+  IN CONST CHAR16                  *FilePath
+  )
+{
+  NDK_UI_IMAGE                     *Image;
+  
+  Image = FindAsset (FilePath);
+  if (Image == NULL) {
+    Image = DecodePNGFile (FilePath);
+    AddAsset (FilePath, Image);
+  }
+  
+  return Image;
+}
+
+STATIC
+VOID
+LoadIconCache (
+  VOID
+  )
+{
+  CHAR16                           Path[64];
+  VOID                             *Buffer;
+  UINT32                           BufferSize;
+  
+  if (GetIconCacheScale () != 0 || mFileSystem == NULL) {
+    return;
+  }
+  
+  //
+  // Scaled icons only fit the scale and screen height they were made for, each scale has its own file.
+  //
+  UnicodeSPrint (Path, sizeof (Path), UI_ICON_CACHE_FILE, (UINT32) mUiScale);
+  BufferSize = 0;
+  Buffer = ReadFile (mFileSystem, Path, &BufferSize, BASE_16MB);
+  InitIconCache (Buffer, BufferSize, (UINT32) mUiScale, (UINT32) mScreenHeight);
+}
+
+STATIC
+VOID
+SaveIconCache (
+  VOID
+  )
+{
+  CHAR16                           Path[64];
+  VOID                             *Data;
+  UINTN                            DataSize;
+  
+  Data = IconCacheData (&DataSize);
+  if (Data == NULL) {
+    return;
+  }
+  
+  UnicodeSPrint (Path, sizeof (Path), UI_ICON_CACHE_FILE, GetIconCacheScale ());
+  DEBUG ((DEBUG_INFO, "OCUI: Icon cache saved, %u KB - %r\n", (UINT32) (DataSize / SIZE_1KB), SaveEspFile (Path, Data, DataSize)));
+  FreePool (Data);
+}
+
+STATIC
+CONST CHAR16 *
+GetIconPath (
+  IN CHAR16               *Name,
+  IN OC_BOOT_ENTRY_TYPE   Type
+  )
+{
+  CONST CHAR16           *FilePath;
+  
+  switch (Type) {
+    case OC_BOOT_WINDOWS:
+      if (StrStr (Name, L"10") != NULL) {
+        FilePath = UI_ICON_WIN10;
+      } else {
+        FilePath = UI_ICON_WIN;
+      }
+      break;
+    case OC_BOOT_APPLE_OS:
+      if (StrStr (Name, L"Install") != NULL) {
+        FilePath = UI_ICON_INSTALL;
+      } else if (StrStr (Name, L"Cata") != NULL) {
+        FilePath = UI_ICON_MAC_CATA;
+      } else if (StrStr (Name, L"Moja") != NULL) {
+        FilePath = UI_ICON_MAC_MOJA;
+      } else if (StrStr (Name, L"Clone") != NULL) {
+        FilePath = UI_ICON_CLONE;
+      } else {
+        FilePath = UI_ICON_MAC;
+      }
+      break;
+    case OC_BOOT_APPLE_RECOVERY:
+      FilePath = UI_ICON_MAC_RECOVERY;
+      break;
+    case OC_BOOT_APPLE_TIME_MACHINE:
+      FilePath = UI_ICON_CLONE;
+      break;
+    case OC_BOOT_EXTERNAL_OS:
+      if (StrStr (Name, L"Free") != NULL) {
+        FilePath = UI_ICON_FREEBSD;
+      } else if (StrStr (Name, L"Arch") != NULL) {
+        FilePath = UI_ICON_ARCH;
+      } else if (StrStr (Name, L"Debian") != NULL) {
+        FilePath = UI_ICON_DEBIAN;
+      } else if (StrStr (Name, L"Fedora") != NULL) {
+        FilePath = UI_ICON_FEDORA;
+      } else if (StrStr (Name, L"Linux") != NULL) {
+        FilePath = UI_ICON_LINUX;
+      } else if (StrStr (Name, L"Redhat") != NULL) {
+        FilePath = UI_ICON_REDHAT;
+      } else if (StrStr (Name, L"Ubuntu") != NULL) {
+        FilePath = UI_ICON_UBUNTU;
+      } else if (StrStr (Name, L"10") != NULL) {
+        FilePath = UI_ICON_WIN10;
+      } else if (StrStr (Name, L"Win") != NULL) {
+        FilePath = UI_ICON_WIN;
+      } else {
+        FilePath = UI_ICON_CUSTOM;
+      }
+      break;
+    case OC_BOOT_EXTERNAL_TOOL:
+      if (StrStr (Name, L"Shell") != NULL) {
+        FilePath = UI_ICON_SHELL;
+      } else {
+          FilePath = UI_ICON_CUSTOM;
+      }
+      break;
+    case OC_BOOT_APPLE_ANY:
+      FilePath = UI_ICON_MAC;
+      break;
+    case OC_BOOT_RESET_NVRAM:
+      FilePath = UI_ICON_RESETNVRAM;
+      break;
+    case OC_BOOT_UNKNOWN:
+      FilePath = UI_ICON_UNKNOWN;
+      break;
+      
+    default:
+      FilePath = UI_ICON_UNKNOWN;
+      break;
+  }
+  
+  return FilePath;
 }
 
+//
+// Icons and toolbar images are read and decoded here in one pass, the application processors
+// convert them to the screen pixel order and build their mip levels while the next one decodes.
+//
 STATIC
-NDK_UI_IMAGE *
-DecodePNGFile (
-  IN CONST CHAR16                  *FilePath
+VOID
+PreloadAssets (
+  IN OC_BOOT_ENTRY        *Entries,
+  IN UINTN                Count
   )
 {
-  VOID                             *Buffer;
-  UINT32                           BufferSize;
+  NDK_UI_LOAD_JOB        Jobs[UI_LOAD_ASSETS_MAX];
+  CONST CHAR16           *Paths[UI_LOAD_ASSETS_MAX];
+  UINTN                  PathCount;
+  UINTN                  JobCount;
+  UINTN                  Index;
+  UINTN                  Other;
+  NDK_UI_IMAGE           *Image;
+  NDK_UI_FILE_STAMP      Stamp;
+  VOID                   *Buffer;
+  UINT32                 BufferSize;
+  UINT32                 Width;
+  UINT32                 Height;
+  
+  LoadIconCache ();
+  
+  PathCount = 0;
+  for (Index = 0; Index < Count && PathCount < UI_LOAD_ASSETS_MAX - 3; ++Index) {
+    Paths[PathCount++] = GetIconPath (Entries[Index].Name, Entries[Index].Type);
+  }
+  Paths[PathCount++] = UI_ICON_RESET;
+  Paths[PathCount++] = UI_IMAGE_SELECTOR_FUNC;
+  Paths[PathCount++] = UI_ICON_SHUTDOWN;
   
-  Buffer = NULL;
-  BufferSize = 0;
+  StartAssetLoader ();
   
-  ASSERT (FilePath != NULL);
-  ASSERT (StrLen (FilePath) > 0);
+  JobCount = 0;
+  for (Index = 0; Index < PathCount; ++Index) {
+    Other = 0;
+    while (Other < Index && StrCmp (Paths[Other], Paths[Index]) != 0) {
+      ++Other;
+    }
+    if (Other < Index) {
+      continue;
+    }
   
-  Buffer = ReadFile (mFileSystem, FilePath, &BufferSize, BASE_16MB);
+    //
+    // Icons the icon cache already holds at this scale are never decoded.
+    //
+    if (EFI_ERROR (GetFileStamp (Paths[Index], &Stamp)) || FindCachedIcon (Paths[Index], &Stamp) != NULL) {
+      continue;
+    }
   
-  if (Buffer == NULL) {
-    DEBUG ((DEBUG_ERROR, "OCUI: Failed to locate %s file\n", FilePath));
-    return NULL;
+    Image = FindAsset (Paths[Index]);
+    if (Image != NULL) {
+      ReleaseAsset (Image);
+      continue;
+    }
+  
+    BufferSize = 0;
+    Buffer = ReadFile (mFileSystem, Paths[Index], &BufferSize, BASE_16MB);
+    if (Buffer == NULL) {
+      continue;
+    }
+  
+    //
+    // Over budget assets are left to LoadAsset, it knows how to fall back.
+    //
+    if (EFI_ERROR (GetPngDimensions (Buffer, BufferSize, &Width, &Height))
+        || !ReserveImageBytes ((UINTN) Width * Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL))) {
+      FreePool (Buffer);
+      continue;
+    }
+  
+    Image = DecodePNGRgba (Buffer, BufferSize);
+    if (Image == NULL) {
+      continue;
+    }
+  
+    Jobs[JobCount].Path = Paths[Index];
+    PrepareAssetMips (Image, &Jobs[JobCount].Mips);
+    QueueLoadJob (&Jobs[JobCount]);
+    ++JobCount;
   }
   
-  return DecodePNG (Buffer, BufferSize);
+  StopAssetLoader ();
+  
+  for (Index = 0; Index < JobCount; ++Index) {
+    Image = Jobs[Index].Mips.Levels[0];
+    AddAssetChain (Jobs[Index].Path, &Jobs[Index].Mips);
+    ReleaseAsset (Image);
+  }
 }
 
 STATIC
@@ -503,20 +1538,11 @@ TakeScreenShot (
   )
 {
   EFI_STATUS              Status;
-  EFI_FILE_PROTOCOL       *Fs;
   EFI_TIME                Date;
   NDK_UI_IMAGE            *Image;
-  EFI_UGA_PIXEL           *ImagePNG;
-  VOID                    *Buffer;
-  UINTN                   BufferSize;
-  UINTN                   Index;
-  UINTN                   ImageSize;
   CHAR16                  *Path;
   UINTN                   Size;
   
-  Buffer     = NULL;
-  BufferSize = 0;
-  
   Status = gRT->GetTime (&Date, NULL);
   if (EFI_ERROR (Status)) {
     ZeroMem (&Date, sizeof (Date));
@@ -524,6 +1550,9 @@ TakeScreenShot (
   
   Size = StrSize (FilePath) + L_STR_SIZE (L"-0000-00-00-000000.png");
   Path = AllocatePool (Size);
+  if (Path == NULL) {
+    return;
+  }
   UnicodeSPrint (Path,
                  Size,
                  L"%s-%04u-%02u-%02u-%02u%02u%02u.png",
@@ -539,164 +1568,464 @@ TakeScreenShot (
   Image = CreateImage (mScreenWidth, mScreenHeight, FALSE);
   if (Image == NULL) {
     DEBUG ((DEBUG_INFO, "Failed to take screen shot!\n"));
+    FreePool (Path);
     return;
   }
     
   TakeImage (Image, 0, 0, mScreenWidth, mScreenHeight);
   
-  ImagePNG = (EFI_UGA_PIXEL *) Image->Bitmap;
-  ImageSize = Image->Width * Image->Height;
+  Status = SavePngFile (Image, Path);
+  DEBUG ((DEBUG_INFO, "OCUI: Screenshot was taken - %r\n", Status));
+  FreeImage (Image);
+  FreePool (Path);
+}
+
+STATIC
+NDK_UI_IMAGE *
+CreateIcon (
+  IN CHAR16               *Name,
+  IN OC_BOOT_ENTRY_TYPE   Type,
+  IN UINTN                IconCount,
+  IN BOOLEAN              Ext,
+  IN BOOLEAN              Dmg
+  )
+{
+  CONST CHAR16           *FilePath;
+  NDK_UI_IMAGE           *Icon;
+  NDK_UI_IMAGE           *ScaledImage;
+  INTN                   IconScale;
+  INTN                   Ratio;
+  UINT16                 SourceWidth;
+  EFI_STATUS             Status;
+  BOOLEAN                IsPlaceholder;
+  NDK_UI_FILE_STAMP      Stamp;
+  NDK_UI_ICON_CACHE_ENTRY *Cached;
   
-  // Convert BGR to RGBA with Alpha set to 0xFF
-  for (Index = 0; Index < ImageSize; ++Index) {
-      UINT8 Temp = ImagePNG[Index].Blue;
-      ImagePNG[Index].Blue = ImagePNG[Index].Red;
-      ImagePNG[Index].Red = Temp;
-      ImagePNG[Index].Reserved = 0xFF;
+  Icon = NULL;
+  ScaledImage = NULL;
+  IconScale = 16;
+  UI_PROFILE_BEGIN (UiProfileCreateIcon);
+  
+  FilePath = GetIconPath (Name, Type);
+  
+  //
+  // A cached icon still supplies the source width, the layout below depends on it.
+  //
+  Icon = NULL;
+  Cached = NULL;
+  Status = GetFileStamp (FilePath, &Stamp);
+  if (!EFI_ERROR (Status)) {
+    Cached = FindCachedIcon (FilePath, &Stamp);
+  }
+  
+  if (Cached == NULL && Status != EFI_NOT_FOUND) {
+    Icon = LoadAsset (FilePath);
+  }
+  
+  IsPlaceholder = FALSE;
+  if (Cached == NULL && Icon == NULL) {
+    Icon = CreateFilledImage ((mIconSpaceSize - (mIconPaddingSize * 2)), (mIconSpaceSize - (mIconPaddingSize * 2)), TRUE, &mBluePixel);
+    IsPlaceholder = TRUE;
+  }
+  
+  if (Cached == NULL && Icon == NULL) {
+    UI_PROFILE_END (UiProfileCreateIcon);
+    return NULL;
+  }
+  
+  SourceWidth = (Cached != NULL) ? Cached->SourceWidth : Icon->Width;
+  
+  if (SourceWidth == 256 && mScreenHeight < 2160) {
+    IconScale = 8;
+  }
+  
+  if (SourceWidth == 256 && mScreenHeight <= 800) {
+    IconScale = 4;
+  }
+  
+  if (SourceWidth > 128 && IconCount == 0) {
+    mIconSpaceSize = ((SourceWidth * IconScale) >> 4) + (mIconPaddingSize * 2);
+    mUiScale = (mUiScale == 8) ? 8 : 16;
+  }
+  
+  Ratio = (IconScale < mUiScale) ? IconScale : mUiScale;
+  
+  if (Cached != NULL) {
+    ScaledImage = CopyCachedIcon (Cached, Ratio);
+    if (ScaledImage != NULL) {
+      UI_PROFILE_END (UiProfileCreateIcon);
+      TimelineMark ("CreateIcon", Name);
+      return ScaledImage;
+    }
+    //
+    // The cache only spared the decode, a file that no longer loads still gets the placeholder.
+    //
+    Icon = LoadAsset (FilePath);
+    if (Icon == NULL) {
+      Icon = CreateFilledImage ((mIconSpaceSize - (mIconPaddingSize * 2)), (mIconSpaceSize - (mIconPaddingSize * 2)), TRUE, &mBluePixel);
+      IsPlaceholder = TRUE;
+    }
+    if (Icon == NULL) {
+      UI_PROFILE_END (UiProfileCreateIcon);
+      return NULL;
+    }
+  }
+  
+  ScaledImage = CopyScaledAsset (Icon, Ratio);
+  ReleaseAsset (Icon);
+  if (!EFI_ERROR (Status) && !IsPlaceholder) {
+    StoreCachedIcon (FilePath, &Stamp, SourceWidth, Ratio, ScaledImage);
+  }
+  UI_PROFILE_END (UiProfileCreateIcon);
+  if (ScaledImage != NULL) {
+    TimelineMark ("CreateIcon", Name);
+  }
+  return ScaledImage;
+}
+
+STATIC
+NDK_UI_IMAGE *
+CreateIconTile (
+  IN UINTN               IconIndex,
+  IN NDK_UI_TILE         Tile
+  )
+{
+  NDK_UI_IMAGE           *NewImage;
+  AREA_RECT              *Rect;
+  INTN                   Xpos;
+  INTN                   Ypos;
+  INTN                   Offset;
+  INTN                   IconOffset;
+  INTN                   AnimatedDistance;
+  
+  AnimatedDistance = (mIconPaddingSize + 1) >> 1;
+  
+  if (!GetIconPosition (IconIndex, &Xpos, &Ypos)) {
+    return NULL;
+  }
+  
+  NewImage = CreateImage (mIconSpaceSize, mIconSpaceSize + AnimatedDistance, FALSE);
+  if (NewImage == NULL) {
+    return NULL;
+  }
+  
+  CopyTiledImageArea (mBackground,
+                      Xpos,
+                      Ypos - AnimatedDistance,
+                      mIconSpaceSize,
+                      mIconSpaceSize + AnimatedDistance,
+                      NewImage->Bitmap,
+                      mIconSpaceSize
+                      );
+  
+  if (Tile != UiTileNormal && mSelectorUsed && mScaledSelectionImage != NULL) {
+    Offset = (NewImage->Width - mScaledSelectionImage->Width) >> 1;
+    
+    RawCompose (NewImage->Bitmap + (Tile == UiTilePressed ? Offset + AnimatedDistance : Offset) * NewImage->Width + Offset,
+                mScaledSelectionImage->Bitmap,
+                mScaledSelectionImage->Width,
+                mScaledSelectionImage->Height,
+                NewImage->Width,
+                mScaledSelectionImage->Width
+                );
+  }
+  
+  Rect = &mIconRects[IconIndex];
+  if (Rect->Width != 0) {
+    IconOffset = ((INTN) mIconSpaceSize - (Rect->Width + (INTN) (mIconPaddingSize * 2))) > 0 ? ((INTN) mIconSpaceSize - (Rect->Width + (INTN) (mIconPaddingSize * 2))) / 2 : 0;
+    
+    RawComposeColor (NewImage->Bitmap + ((Tile == UiTileSelected ? mIconPaddingSize : mIconPaddingSize + AnimatedDistance) + IconOffset) * NewImage->Width + mIconPaddingSize + IconOffset,
+                     mIconAtlas->Image.Bitmap + Rect->Ypos * mIconAtlas->Image.Width + Rect->Xpos,
+                     Rect->Width,
+                     Rect->Height,
+                     NewImage->Width,
+                     mIconAtlas->Image.Width,
+                     Tile == UiTileNormal ? ICON_BRIGHTNESS_FULL : ICON_BRIGHTNESS_LEVEL
+                     );
+  }
+  
+  return NewImage;
+}
+
+STATIC
+VOID
+FreeIconTiles (
+  IN UINTN               IconIndex
+  )
+{
+  UINTN                  Tile;
+  
+  for (Tile = 0; Tile < UiTileMax; ++Tile) {
+    if (mIconTiles[IconIndex][Tile] != NULL) {
+      FreeImage (mIconTiles[IconIndex][Tile]);
+      mIconTiles[IconIndex][Tile] = NULL;
+    }
+  }
+}
+
+//
+// A tile carries the background strip behind the row its icon sat in when it was made,
+// so once the menu scrolls every tile still on screen has to be made again.
+//
+STATIC
+VOID
+DropStaleIconTiles (
+  VOID
+  )
+{
+  UINTN                  Index;
+  
+  if (mIconTilesTopRow == mMenuTopRow) {
+    return;
+  }
+  
+  for (Index = 0; Index < OC_INPUT_MAX; ++Index) {
+    FreeIconTiles (Index);
+  }
+  mIconTilesTopRow = mMenuTopRow;
+}
+
+STATIC
+VOID
+BakeIconTiles (
+  IN UINTN               IconCount
+  )
+{
+  UINTN                  Index;
+  UINTN                  Tile;
+  UINTN                  Row;
+  
+  DropStaleIconTiles ();
+  for (Index = 0; Index < IconCount; ++Index) {
+    Row = Index / mIconsPerRow;
+    if (Row < mMenuTopRow || Row >= mMenuTopRow + UI_MENU_VISIBLE_ROWS) {
+      FreeIconTiles (Index);
+      continue;
+    }
+    
+    for (Tile = 0; Tile < UiTileMax; ++Tile) {
+      if (mIconTiles[Index][Tile] == NULL) {
+        mIconTiles[Index][Tile] = CreateIconTile (Index, (NDK_UI_TILE) Tile);
+      }
+    }
+  }
+}
+
+STATIC
+VOID
+DrawIconTile (
+  IN UINTN               IconIndex,
+  IN NDK_UI_TILE         Tile
+  )
+{
+  INTN                   Xpos;
+  INTN                   Ypos;
+  
+  if (!GetIconPosition (IconIndex, &Xpos, &Ypos)) {
+    return;
+  }
+  
+  DropStaleIconTiles ();
+  if (mIconTiles[IconIndex][Tile] == NULL) {
+    mIconTiles[IconIndex][Tile] = CreateIconTile (IconIndex, Tile);
+  }
+  
+  BltImage (mIconTiles[IconIndex][Tile], Xpos, Ypos - (INTN) ((mIconPaddingSize + 1) >> 1));
+}
+
+STATIC
+BOOLEAN
+SelectionBounceStep (
+  IN VOID                *Context,
+  IN UINT64              Elapsed
+  )
+{
+  if (Elapsed < UI_ANIMATION_BOUNCE_TIME) {
+    return FALSE;
+  }
+  
+  if (mSelectedIcon >= 0) {
+    mSelectedTile = UiTileSelected;
+    DrawIconTile ((UINTN) mSelectedIcon, mSelectedTile);
+  }
+  return TRUE;
+}
+
+STATIC
+BOOLEAN
+MenuFadeStep (
+  IN VOID                *Context,
+  IN UINT64              Elapsed
+  )
+{
+  UINTN                  Row;
+  
+  if (Elapsed >= UI_ANIMATION_FADE_TIME) {
+    mMenuColorDiff = ICON_BRIGHTNESS_FULL;
+  } else {
+    mMenuColorDiff = -(INTN) DivU64x64Remainder (MultU64x32 (UI_ANIMATION_FADE_TIME - Elapsed, -ICON_BRIGHTNESS_OFF), UI_ANIMATION_FADE_TIME, NULL);
+  }
+  
+  for (Row = mMenuTopRow; Row < mMenuTopRow + UI_MENU_VISIBLE_ROWS; ++Row) {
+    DrawMenuRow ((UINTN) mMenuIconsCount, Row);
+  }
+  
+  if (mSelectedIcon >= 0) {
+    DrawIconTile ((UINTN) mSelectedIcon, mSelectedTile);
+  }
+  
+  return mMenuColorDiff == ICON_BRIGHTNESS_FULL;
+}
+
+STATIC
+VOID
+FreeMenuIcons (
+  VOID
+  )
+{
+  UINTN                  Index;
+  
+  for (Index = 0; Index < OC_INPUT_MAX; ++Index) {
+    FreeIconTiles (Index);
   }
+  
+  FreeImage (mScaledSelectionImage);
+  mScaledSelectionImage = NULL;
+  FreeAtlas (mIconAtlas);
+  mIconAtlas = NULL;
+  ZeroMem (mIconRects, sizeof (mIconRects));
+}
 
-  // Encode raw RGB image to PNG format
-  Status = EncodePng (ImagePNG,
-                      (UINTN) Image->Width,
-                      (UINTN) Image->Height,
-                      &Buffer,
-                      &BufferSize
-                      );
-  FreeImage (Image);
-  if (Buffer == NULL) {
-    DEBUG ((DEBUG_INFO, "OCUI: Fail Encoding!\n"));
-    return;
+STATIC
+VOID
+AddMenuIcon (
+  IN OC_BOOT_ENTRY       *Entries,
+  IN UINTN               *VisibleList,
+  IN UINTN               Index,
+  IN NDK_UI_IMAGE        *Icon
+  )
+{
+  if (Icon == NULL) {
+    Icon = CreateIcon (Entries[VisibleList[Index]].Name,
+                       Entries[VisibleList[Index]].Type,
+                       Index,
+                       Entries[VisibleList[Index]].IsExternal,
+                       Entries[VisibleList[Index]].IsFolder
+                       );
+    if (Icon == NULL) {
+      return;
+    }
   }
   
-  Status = mFileSystem->OpenVolume (mFileSystem, &Fs);
-  if (EFI_ERROR (Status)) {
-    DEBUG ((DEBUG_INFO, "OCUI: Locating Writeable file system - %r\n", Status));
-    return;
-  }
+  AtlasAddImage (mIconAtlas, Icon, &mIconRects[Index]);
+  FreeImage (Icon);
+}
+
+STATIC
+VOID
+LoadMenuIcons (
+  IN OC_BOOT_ENTRY       *Entries,
+  IN UINTN               *VisibleList,
+  IN UINTN               IconCount
+  )
+{
+  UINTN                  Index;
+  UINTN                  Row;
+  UINTN                  FirstRow;
+  UINTN                  LastRow;
   
-  Status = SetFileData (Fs, Path, Buffer, (UINT32) BufferSize);
-  DEBUG ((DEBUG_INFO, "OCUI: Screenshot was taken - %r\n", Status));
-  if (Buffer != NULL) {
-    FreePool (Buffer);
+  //
+  // Only the visible rows and one row before and after them stay in the atlas.
+  //
+  FirstRow = mMenuTopRow > 0 ? mMenuTopRow - 1 : 0;
+  LastRow = mMenuTopRow + UI_MENU_VISIBLE_ROWS;
+  
+  for (Index = 0; Index < IconCount; ++Index) {
+    Row = Index / mIconsPerRow;
+    if (Row < FirstRow || Row > LastRow) {
+      AtlasRemoveImage (mIconAtlas, &mIconRects[Index]);
+    }
   }
-  if (Path != NULL) {
-    FreePool (Path);
+  
+  for (Index = FirstRow * mIconsPerRow; Index < IconCount && Index < (LastRow + 1) * mIconsPerRow; ++Index) {
+    if (mIconRects[Index].Width == 0) {
+      AddMenuIcon (Entries, VisibleList, Index, NULL);
+    }
   }
+  
+  BakeIconTiles (IconCount);
 }
 
 STATIC
 VOID
-CreateIcon (
-  IN CHAR16               *Name,
-  IN OC_BOOT_ENTRY_TYPE   Type,
-  IN UINTN                IconCount,
-  IN BOOLEAN              Ext,
-  IN BOOLEAN              Dmg
+CreateMenu (
+  IN OC_BOOT_ENTRY       *Entries,
+  IN UINTN               *VisibleList,
+  IN UINTN               IconCount,
+  IN UINTN               Selected
   )
 {
-  CONST CHAR16           *FilePath;
   NDK_UI_IMAGE           *Icon;
-  NDK_UI_IMAGE           *ScaledImage;
-  INTN                   IconScale;
+  UINTN                  IconSize;
   
-  Icon = NULL;
-  ScaledImage = NULL;
-  IconScale = 16;
+  UI_PROFILE_BEGIN (UiProfileCreateMenu);
+  StopAnimation (SelectionBounceStep, FALSE);
+  StopAnimation (MenuFadeStep, FALSE);
+  mMenuColorDiff = ICON_BRIGHTNESS_FULL;
+  mSelectedIcon = -1;
   
-  switch (Type) {
-    case OC_BOOT_WINDOWS:
-      if (StrStr (Name, L"10") != NULL) {
-        FilePath = UI_ICON_WIN10;
-      } else {
-        FilePath = UI_ICON_WIN;
-      }
-      break;
-    case OC_BOOT_APPLE_OS:
-      if (StrStr (Name, L"Install") != NULL) {
-        FilePath = UI_ICON_INSTALL;
-      } else if (StrStr (Name, L"Cata") != NULL) {
-        FilePath = UI_ICON_MAC_CATA;
-      } else if (StrStr (Name, L"Moja") != NULL) {
-        FilePath = UI_ICON_MAC_MOJA;
-      } else if (StrStr (Name, L"Clone") != NULL) {
-        FilePath = UI_ICON_CLONE;
-      } else {
-        FilePath = UI_ICON_MAC;
-      }
-      break;
-    case OC_BOOT_APPLE_RECOVERY:
-      FilePath = UI_ICON_MAC_RECOVERY;
-      break;
-    case OC_BOOT_APPLE_TIME_MACHINE:
-      FilePath = UI_ICON_CLONE;
-      break;
-    case OC_BOOT_EXTERNAL_OS:
-      if (StrStr (Name, L"Free") != NULL) {
-        FilePath = UI_ICON_FREEBSD;
-      } else if (StrStr (Name, L"Arch") != NULL) {
-        FilePath = UI_ICON_ARCH;
-      } else if (StrStr (Name, L"Debian") != NULL) {
-        FilePath = UI_ICON_DEBIAN;
-      } else if (StrStr (Name, L"Fedora") != NULL) {
-        FilePath = UI_ICON_FEDORA;
-      } else if (StrStr (Name, L"Linux") != NULL) {
-        FilePath = UI_ICON_LINUX;
-      } else if (StrStr (Name, L"Redhat") != NULL) {
-        FilePath = UI_ICON_REDHAT;
-      } else if (StrStr (Name, L"Ubuntu") != NULL) {
-        FilePath = UI_ICON_UBUNTU;
-      } else if (StrStr (Name, L"10") != NULL) {
-        FilePath = UI_ICON_WIN10;
-      } else if (StrStr (Name, L"Win") != NULL) {
-        FilePath = UI_ICON_WIN;
-      } else {
-        FilePath = UI_ICON_CUSTOM;
-      }
-      break;
-    case OC_BOOT_EXTERNAL_TOOL:
-      if (StrStr (Name, L"Shell") != NULL) {
-        FilePath = UI_ICON_SHELL;
-      } else {
-          FilePath = UI_ICON_CUSTOM;
-      }
-      break;
-    case OC_BOOT_APPLE_ANY:
-      FilePath = UI_ICON_MAC;
-      break;
-    case OC_BOOT_RESET_NVRAM:
-      FilePath = UI_ICON_RESETNVRAM;
-      break;
-    case OC_BOOT_UNKNOWN:
-      FilePath = UI_ICON_UNKNOWN;
-      break;
-      
-    default:
-      FilePath = UI_ICON_UNKNOWN;
-      break;
+  FreeMenuIcons ();
+  mIconsPerRow = 0;
+  
+  if (IconCount == 0) {
+    UI_PROFILE_END (UiProfileCreateMenu);
+    return;
   }
   
-  if (FileExist (FilePath)) {
-    Icon = DecodePNGFile (FilePath);
-  } else {
-    Icon = CreateFilledImage ((mIconSpaceSize - (mIconPaddingSize * 2)), (mIconSpaceSize - (mIconPaddingSize * 2)), TRUE, &mBluePixel);
+  LoadIconCache ();
+  
+  //
+  // The first icon decides the icon space size, so the layout and the atlas slot size
+  // can only be set up after it is loaded.
+  //
+  Icon = CreateIcon (Entries[VisibleList[0]].Name,
+                     Entries[VisibleList[0]].Type,
+                     0,
+                     Entries[VisibleList[0]].IsExternal,
+                     Entries[VisibleList[0]].IsFolder
+                     );
+  SetMenuLayout (IconCount);
+  
+  IconSize = mIconSpaceSize - (mIconPaddingSize * 2);
+  mIconAtlas = CreateAtlas ((UINT16) IconSize,
+                            (UINT16) IconSize,
+                            MIN (IconCount, (UI_MENU_VISIBLE_ROWS + 2) * mIconsPerRow)
+                            );
+  if (mIconAtlas == NULL) {
+    FreeImage (Icon);
+    mIconsPerRow = 0;
+    UI_PROFILE_END (UiProfileCreateMenu);
+    return;
   }
   
-  if (Icon->Width == 256 && mScreenHeight < 2160) {
-    IconScale = 8;
+  if (mSelectorUsed && mSelectionImage != NULL) {
+    mScaledSelectionImage = CopyMipImage (&mSelectionMips, (mSelectionImage->Width == mIconSpaceSize) ? 16 : mUiScale);
   }
   
-  if (Icon->Width == 256 && mScreenHeight <= 800) {
-    IconScale = 4;
+  if (Selected / mIconsPerRow >= UI_MENU_VISIBLE_ROWS) {
+    mMenuTopRow = Selected / mIconsPerRow - (UI_MENU_VISIBLE_ROWS - 1);
   }
   
-  if (Icon->Width > 128 && mMenuImage == NULL) {
-    mIconSpaceSize = ((Icon->Width * IconScale) >> 4) + (mIconPaddingSize * 2);
-    mUiScale = (mUiScale == 8) ? 8 : 16;
+  if (Icon != NULL) {
+    if (mMenuTopRow <= 1) {
+      AddMenuIcon (Entries, VisibleList, 0, Icon);
+    } else {
+      FreeImage (Icon);
+    }
   }
   
-  ScaledImage = CopyScaledImage (Icon, (IconScale < mUiScale) ? IconScale : mUiScale);
-  FreeImage (Icon);
-  CreateMenuImage (ScaledImage, IconCount);
+  LoadMenuIcons (Entries, VisibleList, IconCount);
+  UI_PROFILE_END (UiProfileCreateMenu);
 }
 
 STATIC
@@ -708,186 +2037,144 @@ SwitchIconSelection (
   IN BOOLEAN             Clicked
   )
 {
-  NDK_UI_IMAGE           *NewImage;
-  NDK_UI_IMAGE           *SelectorImage;
-  NDK_UI_IMAGE           *Icon;
-  BOOLEAN                IsTwoRow;
-  INTN                   Xpos;
-  INTN                   Ypos;
-  INTN                   Offset;
-  UINT16                 Width;
-  UINT16                 Height;
-  UINTN                  IconsPerRow;
-  INTN                   IconRowSpace;
-  INTN                   AnimatedDistance;
-  
-  /* Begin Calculating Xpos and Ypos of current selected icon on screen*/
-  NewImage = NULL;
-  Icon = NULL;
-  IsTwoRow = FALSE;
-  Xpos = 0;
-  Ypos = 0;
-  Width = mIconSpaceSize;
-  Height = Width;
-  IconsPerRow = 1;
-  IconRowSpace = (32 * mUiScale >> 4) + ICON_ROW_SPACE_OFFSET;
-  AnimatedDistance = (mIconPaddingSize + 1) >> 1;
+  NDK_UI_TILE            Tile;
+  NDK_UI_GOP_CALLER      Caller;
   
-  for (IconsPerRow = 1; IconsPerRow < IconCount; ++IconsPerRow) {
-    Width = Width + mIconSpaceSize;
-    if ((Width + (mIconSpaceSize * 2)) >= mScreenWidth) {
-      break;
-    }
+  if (IconIndex >= IconCount) {
+    return;
   }
   
-  if (IconsPerRow < IconCount) {
-    IsTwoRow = TRUE;
-    Height = mIconSpaceSize * 2;
-    if (IconIndex <= IconsPerRow) {
-      Xpos = (mScreenWidth - Width) / 2 + (mIconSpaceSize * IconIndex);
-      Ypos = (mScreenHeight / 2) - mIconSpaceSize;
-    } else {
-      Xpos = (mScreenWidth - Width) / 2 + (mIconSpaceSize * (IconIndex - (IconsPerRow + 1)));
-      Ypos = mScreenHeight / 2 + IconRowSpace;
-    }
-  } else {
-    Xpos = (mScreenWidth - Width) / 2 + (mIconSpaceSize * IconIndex);
-    Ypos = (mScreenHeight / 2) - mIconSpaceSize;
+  Caller = GopEnterCaller (UiGopSwitchIcon);
+  StopAnimation (SelectionBounceStep, FALSE);
+  
+  if (Selected) {
+    mSelectedIcon = (INTN) IconIndex;
+  } else if (mSelectedIcon == (INTN) IconIndex) {
+    mSelectedIcon = -1;
   }
-  /* Done Calculating Xpos and Ypos of current selected icon on screen*/
   
-  Icon = CreateImage (mIconSpaceSize - (mIconPaddingSize * 2), mIconSpaceSize - (mIconPaddingSize * 2), TRUE);
-  if (Icon == NULL) {
-    return;
+  //
+  // A newly selected icon lands in the pressed position and bounces up on a later frame.
+  //
+  Tile = !Selected ? UiTileNormal : (Clicked ? UiTilePressed : UiTileSelected);
+  if (Tile == UiTileSelected && StartAnimation (SelectionBounceStep, NULL)) {
+    Tile = UiTilePressed;
   }
   
-  RawCopy (Icon->Bitmap,
-           mMenuImage->Bitmap + ((IconIndex <= IconsPerRow) ? mIconPaddingSize : mIconPaddingSize + mIconSpaceSize + IconRowSpace) * mMenuImage->Width + ((Xpos + mIconPaddingSize) - ((mScreenWidth - Width) / 2)),
-           Icon->Width,
-           Icon->Height,
-           Icon->Width,
-           mMenuImage->Width
-           );
+  mSelectedTile = Tile;
+  DrawIconTile (IconIndex, Tile);
+  GopLeaveCaller (Caller);
+}
+
+STATIC
+VOID
+DrawBackgroundArea (
+  IN INTN                       Xpos,
+  IN INTN                       Ypos,
+  IN INTN                       Width,
+  IN INTN                       Height
+  )
+{
+  NDK_UI_IMAGE                  *Band;
+  INTN                          Row;
+  INTN                          Rows;
+  BOOLEAN                       NewFrame;
   
-  if (Selected && mSelectorUsed) {
-    NewImage = CreateImage (mIconSpaceSize, mIconSpaceSize + AnimatedDistance, FALSE);
-    
-    RawCopy (NewImage->Bitmap,
-             mBackgroundImage->Bitmap + (Ypos - AnimatedDistance) * mBackgroundImage->Width + Xpos,
-             mIconSpaceSize,
-             mIconSpaceSize + AnimatedDistance,
-             mIconSpaceSize,
-             mBackgroundImage->Width
-             );
-    
-    SelectorImage = CopyScaledImage (mSelectionImage, (mSelectionImage->Width == mIconSpaceSize) ? 16 : mUiScale);
-    
-    Offset = (NewImage->Width - SelectorImage->Width) >> 1;
-    
-    RawCompose (NewImage->Bitmap + (Clicked ? Offset + AnimatedDistance : Offset) * NewImage->Width + Offset,
-                SelectorImage->Bitmap,
-                SelectorImage->Width,
-                SelectorImage->Height,
-                NewImage->Width,
-                SelectorImage->Width
-                );
-    
-    FreeImage (SelectorImage);
-  } else {
-    NewImage = CreateImage (mIconSpaceSize, mIconSpaceSize + AnimatedDistance, FALSE);
-    
-    RawCopy (NewImage->Bitmap,
-             mBackgroundImage->Bitmap + (Ypos - AnimatedDistance) * mBackgroundImage->Width + Xpos,
-             mIconSpaceSize,
-             mIconSpaceSize + AnimatedDistance,
-             mIconSpaceSize,
-             mBackgroundImage->Width
-             );
+  Band = CreateImage ((UINT16) Width, UI_TILE_SIZE, FALSE);
+  if (Band == NULL) {
+    return;
   }
   
-  RawComposeColor (NewImage->Bitmap + ((Selected && !Clicked) ? mIconPaddingSize : mIconPaddingSize + AnimatedDistance) * NewImage->Width + mIconPaddingSize,
-                   Icon->Bitmap,
-                   Icon->Width,
-                   Icon->Height,
-                   NewImage->Width,
-                   Icon->Width,
-                   !Selected ? ICON_BRIGHTNESS_FULL : ICON_BRIGHTNESS_LEVEL
-                   );
+  //
+  // The bands only land in the scene, the whole area is presented once at the end.
+  //
+  NewFrame = UiBeginFrame ();
+  for (Row = 0; Row < Height; Row += UI_TILE_SIZE) {
+    Rows = MIN (UI_TILE_SIZE, Height - Row);
+    CopyTiledImageArea (mBackground, Xpos, Ypos + Row, Width, Rows, Band->Bitmap, Width);
+    DrawImageArea (Band, 0, 0, Width, Rows, Xpos, Ypos + Row);
+  }
+  if (NewFrame) {
+    UiEndFrame ();
+  }
   
-  FreeImage (Icon);
-  BltImage (NewImage, Xpos, Ypos - AnimatedDistance);
-  FreeImage (NewImage);
+  FreeImage (Band);
 }
 
-VOID
+STATIC
+NDK_UI_IMAGE *
 ScaleBackgroundImage (
-  VOID
+  IN NDK_UI_IMAGE               *Image
   )
 {
-  NDK_UI_IMAGE                  *Image;
+  NDK_UI_IMAGE                  *NewImage;
+  INTN                          Ratio;
   INTN                          OffsetX;
   INTN                          OffsetX1;
   INTN                          OffsetX2;
   INTN                          OffsetY;
   INTN                          OffsetY1;
   INTN                          OffsetY2;
-  UINTN                         Index;
-  UINTN                         Index1;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Pixel;
+  
+  UI_PROFILE_BEGIN (UiProfileScaleBackground);
+  //
+  // Tiles and scaled rows are written straight into the screen sized image, so only
+  // the decoded source and the final background are alive at the same time.
+  //
+  NewImage = CreateFilledImage (mScreenWidth, mScreenHeight, FALSE, &mGrayPixel);
+  if (NewImage == NULL) {
+    FreeImage (Image);
+    UI_PROFILE_END (UiProfileScaleBackground);
+    return NULL;
+  }
   
   // Tile //
-  if (mBackgroundImage->Width < (mScreenWidth / 4)) {
-    Image = CopyImage (mBackgroundImage);
-    FreeImage (mBackgroundImage);
-    mBackgroundImage = CreateFilledImage (mScreenWidth, mScreenHeight, FALSE, &mGrayPixel);
-    
+  if (Image->Width < (mScreenWidth / 4)) {
     OffsetX = (Image->Width * ((mScreenWidth - 1) / Image->Width + 1) - mScreenWidth) >> 1;
     OffsetY = (Image->Height * ((mScreenHeight - 1) / Image->Height + 1) - mScreenHeight) >> 1;
     
-    Pixel = mBackgroundImage->Bitmap;
-    for (Index = 0; Index < mScreenHeight; Index++) {
-      OffsetY1 = ((Index + OffsetY) % Image->Height) * Image->Width;
-      for (Index1 = 0; Index1 < mScreenWidth; Index1++) {
-        *Pixel++ = Image->Bitmap[OffsetY1 + ((Index1 + OffsetX) % Image->Width)];
-      }
-    }
+    TileImageArea (NewImage->Bitmap, mScreenWidth, mScreenWidth, mScreenHeight, Image, OffsetX, OffsetY);
   // Scale & Crop //
   } else {
-    Image = CopyScaledImage (mBackgroundImage, (mScreenWidth << 4) / mBackgroundImage->Width);
-    FreeImage (mBackgroundImage);
-    mBackgroundImage = CreateFilledImage (mScreenWidth, mScreenHeight, FALSE, &mGrayPixel);
+    Ratio = (mScreenWidth << 4) / Image->Width;
     
-    OffsetX = mScreenWidth - Image->Width;
+    OffsetX = mScreenWidth - ((Image->Width * Ratio) >> 4);
     if (OffsetX >= 0) {
       OffsetX1 = OffsetX >> 1;
       OffsetX2 = 0;
-      OffsetX = Image->Width;
+      OffsetX = (Image->Width * Ratio) >> 4;
     } else {
       OffsetX1 = 0;
       OffsetX2 = (-OffsetX) >> 1;
       OffsetX = mScreenWidth;
     }
     
-    OffsetY = mScreenHeight - Image->Height;
+    OffsetY = mScreenHeight - ((Image->Height * Ratio) >> 4);
     if (OffsetY >= 0) {
       OffsetY1 = OffsetY >> 1;
       OffsetY2 = 0;
-      OffsetY = Image->Height;
+      OffsetY = (Image->Height * Ratio) >> 4;
     } else {
       OffsetY1 = 0;
       OffsetY2 = (-OffsetY) >> 1;
       OffsetY = mScreenHeight;
     }
     
-    RawCopy (mBackgroundImage->Bitmap + OffsetY1 * mScreenWidth + OffsetX1,
-             Image->Bitmap + OffsetY2 * Image->Width + OffsetX2,
-             OffsetX,
-             OffsetY,
-             mScreenWidth,
-             Image->Width
-             );
+    if (Ratio == 16) {
+      RawCopy (NewImage->Bitmap + OffsetY1 * mScreenWidth + OffsetX1,
+               Image->Bitmap + OffsetY2 * Image->Width + OffsetX2,
+               OffsetX,
+               OffsetY,
+               mScreenWidth,
+               Image->Width
+               );
+    } else {
+      ScaleImageArea (NewImage, OffsetX1, OffsetY1, Image, Ratio, OffsetX2, OffsetY2, OffsetX, OffsetY);
+    }
   }
   FreeImage (Image);
+  UI_PROFILE_END (UiProfileScaleBackground);
+  return NewImage;
 }
 
 STATIC
@@ -897,18 +2184,30 @@ ClearScreen (
   )
 {
   NDK_UI_IMAGE                  *Image;
+  NDK_UI_GOP_CALLER             Caller;
   
+  Caller = GopEnterCaller (UiGopClearScreen);
+  
+  Image = NULL;
   if (FileExist (UI_IMAGE_BACKGROUND) && mScreenHeight >= 2160) {
-    mBackgroundImage = DecodePNGFile (UI_IMAGE_BACKGROUND);
+    Image = DecodePNGFileOrFallback (UI_IMAGE_BACKGROUND, UI_IMAGE_BACKGROUND_ALT);
   } else if (FileExist (UI_IMAGE_BACKGROUND_ALT)) {
-    mBackgroundImage = DecodePNGFile (UI_IMAGE_BACKGROUND_ALT);
+    Image = DecodePNGFile (UI_IMAGE_BACKGROUND_ALT);
+  }
+  
+  if (Image != NULL && (Image->Width != mScreenWidth || Image->Height != mScreenHeight)) {
+    Image = ScaleBackgroundImage (Image);
   }
   
-  if (mBackgroundImage != NULL && (mBackgroundImage->Width != mScreenWidth || mBackgroundImage->Height != mScreenHeight)) {
-    ScaleBackgroundImage ();
+  //
+  // The background is only kept as tiles, flat areas and gradients cost next to nothing.
+  //
+  if (Image != NULL) {
+    mBackground = CreateTiledImage (Image);
+    FreeImage (Image);
   }
   
-  if (mBackgroundImage == NULL) {
+  if (mBackground == NULL) {
     if (FileExist (UI_IMAGE_BACKGROUND_COLOR)) {
       Image = DecodePNGFile (UI_IMAGE_BACKGROUND_COLOR);
       if (Image != NULL) {
@@ -917,11 +2216,11 @@ ClearScreen (
       }
       FreeImage (Image);
     }
-    mBackgroundImage = CreateFilledImage (mScreenWidth, mScreenHeight, FALSE, mBackgroundPixel);
+    mBackground = CreateFilledTiledImage (mScreenWidth, mScreenHeight, mBackgroundPixel);
   }
   
-  if (mBackgroundImage != NULL) {
-    BltImage (mBackgroundImage, 0, 0);
+  if (mBackground != NULL) {
+    DrawBackgroundArea (0, 0, mScreenWidth, mScreenHeight);
   }
   
   if (FileExist (UI_IMAGE_FONT_COLOR)) {
@@ -938,12 +2237,13 @@ ClearScreen (
   }
   
   if (mSelectorUsed && FileExist (UI_IMAGE_SELECTOR) && mScreenHeight >= 2160) {
-    mSelectionImage = DecodePNGFile (UI_IMAGE_SELECTOR);
+    mSelectionImage = DecodePNGFileOrFallback (UI_IMAGE_SELECTOR, UI_IMAGE_SELECTOR_ALT);
   } else if (mSelectorUsed && FileExist (UI_IMAGE_SELECTOR_ALT)) {
     mSelectionImage = DecodePNGFile (UI_IMAGE_SELECTOR_ALT);
   } else {
     mSelectionImage = CreateFilledImage (mIconSpaceSize, mIconSpaceSize, FALSE, mFontColorPixel);
   }
+  BuildMipChain (mSelectionImage, &mSelectionMips);
   
   if (FileExist (UI_IMAGE_LABEL_OFF)) {
     mPrintLabel = FALSE;
@@ -954,6 +2254,8 @@ ClearScreen (
   } else {
     mLabelImage = CreateFilledImage (mIconSpaceSize, 32, TRUE, &mTransparentPixel);
   }
+  
+  GopLeaveCaller (Caller);
 }
 
 STATIC
@@ -966,33 +2268,7 @@ ClearScreenArea (
   IN INTN                           Height
   )
 {
-  NDK_UI_IMAGE                      *Image;
-  NDK_UI_IMAGE                      *NewImage;
-  
-  Image = CreateFilledImage (Width, Height, (mBackgroundImage != NULL), Color);
-  if (mBackgroundImage == NULL) {
-    DrawImageArea (Image, 0, 0, 0, 0, Xpos, Ypos);
-    FreeImage (Image);
-    return;
-  }
-  
-  NewImage = CreateImage (Width, Height, FALSE);
-  if (NewImage == NULL) {
-    return;
-  }
-  RawCopy (NewImage->Bitmap,
-           mBackgroundImage->Bitmap + Ypos * mBackgroundImage->Width + Xpos,
-           Width,
-           Height,
-           Width,
-           mBackgroundImage->Width
-           );
-
-  ComposeImage (NewImage, Image, 0, 0);
-  FreeImage (Image);
-
-  DrawImageArea (NewImage, 0, 0, 0, 0, Xpos, Ypos);
-  FreeImage (NewImage);
+  DrawComposedArea (NULL, 16, Color, Xpos, Ypos, Width, Height);
 }
 
 STATIC
@@ -1007,10 +2283,17 @@ InitScreen (
   UINT32            RefreshRate;
   UINT32            ScreenWidth;
   UINT32            ScreenHeight;
+  NDK_UI_IMAGE      *Scene;
   
   Handle = NULL;
   mUgaDraw = NULL;
   //
+  // A virtual display takes over when requested, so the picker can run headless
+  //
+  if (mGraphicsOutput == NULL) {
+    mGraphicsOutput = InitVirtualDisplay (FileExist (UI_IMAGE_VIRTUAL_DISPLAY_ON));
+  }
+  //
   // Try to open GOP first
   //
   if (mGraphicsOutput == NULL) {
@@ -1028,9 +2311,12 @@ InitScreen (
   }
   
   if (mGraphicsOutput != NULL) {
-    Status = OcSetConsoleResolution (0, 0, 0);
+    Status = IsVirtualDisplay (mGraphicsOutput) ? EFI_SUCCESS : OcSetConsoleResolution (0, 0, 0);
     mScreenWidth = mGraphicsOutput->Mode->Info->HorizontalResolution;
     mScreenHeight = mGraphicsOutput->Mode->Info->VerticalResolution;
+    if (FileExist (UI_IMAGE_FRAMEBUFFER_ON)) {
+      DEBUG ((DEBUG_INFO, "OCUI: Direct frame buffer...%r\n", InitFrameBuffer (mGraphicsOutput)));
+    }
   } else {
     ASSERT (mUgaDraw != NULL);
     Status = mUgaDraw->GetMode (mUgaDraw, &ScreenWidth, &ScreenHeight, &ColorDepth, &RefreshRate);
@@ -1055,6 +2341,21 @@ InitScreen (
     mIconPaddingSize = 8;
     mIconSpaceSize = 144;
   }
+  
+  if (mSceneImage == NULL || mSceneImage->Width != mScreenWidth || mSceneImage->Height != mScreenHeight) {
+    FreeImage (mSceneImage);
+    mSceneImage = NULL;
+    mDamageCount = 0;
+    
+    //
+    // Seed the back buffer with what video shows now, this is the only read back from video.
+    //
+    Scene = CreateImage ((UINT16) mScreenWidth, (UINT16) mScreenHeight, FALSE);
+    if (Scene != NULL) {
+      TakeImage (Scene, 0, 0, mScreenWidth, mScreenHeight);
+    }
+    mSceneImage = Scene;
+  }
 }
 //
 // Text rendering
@@ -1158,6 +2459,26 @@ PrepareFont (
   }
 }
 
+//
+// Size classes follow the layout: pointer buffers, icon cells with their animation
+// margin, label and toolbar strips, and a full width line of scaled text. The text
+// line needs the loaded font, so this runs after PrepareFont.
+//
+STATIC
+VOID
+PrepareImageSlabs (
+  VOID
+  )
+{
+  UINTN             SlabPixels[4];
+  
+  SlabPixels[0] = POINTER_WIDTH * POINTER_HEIGHT;
+  SlabPixels[1] = mIconSpaceSize * (mIconSpaceSize + ((mIconPaddingSize + 1) >> 1));
+  SlabPixels[2] = mIconSpaceSize * 32;
+  SlabPixels[3] = mScreenWidth * ((mTextHeight * mTextScale) >> 4);
+  ConfigureImageSlabs (SlabPixels, ARRAY_SIZE (SlabPixels));
+}
+
 
 STATIC
 BOOLEAN
@@ -1236,6 +2557,7 @@ RenderText (
   Shift       = 0;
   RealWidth   = 0;
   
+  UI_PROFILE_BEGIN (UiProfileRenderText);
   TextLength = StrLen (Text);
   if (mFontImage == NULL) {
     PrepareFont();
@@ -1300,6 +2622,7 @@ RenderText (
     }
     BufferPtr += RealWidth - LeftSpace + 2;
   }
+  UI_PROFILE_END (UiProfileRenderText);
   return ((INTN) BufferPtr - (INTN) FirstPixelBuf) / sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
 }
 
@@ -1320,13 +2643,22 @@ CreateTextImage (
     return NULL;
   }
   
+  UI_PROFILE_BEGIN (UiProfileCreateTextImage);
   Width = ((StrLen (String) + 1) * (INTN) CHAR_WIDTH);
   Image = CreateFilledImage (Width, mTextHeight, TRUE, &mTransparentPixel);
-  if (Image != NULL) {
-    TextWidth = RenderText (String, Image, 0, 0, 0xFFFF);
+  if (Image == NULL) {
+    UI_PROFILE_END (UiProfileCreateTextImage);
+    return NULL;
   }
   
+  TextWidth = RenderText (String, Image, 0, 0, 0xFFFF);
   TmpImage = CreateImage (TextWidth, mFontHeight, TRUE);
+  if (TmpImage == NULL) {
+    FreeImage (Image);
+    UI_PROFILE_END (UiProfileCreateTextImage);
+    return NULL;
+  }
+  
   RawCopy (TmpImage->Bitmap,
            Image->Bitmap,
            TmpImage->Width,
@@ -1337,12 +2669,13 @@ CreateTextImage (
   
   FreeImage (Image);
   ScaledTextImage = CopyScaledImage (TmpImage, mTextScale);
+  FreeImage (TmpImage);
     
   if (ScaledTextImage == NULL) {
     DEBUG ((DEBUG_INFO, "OCUI: Failed to scale image!\n"));
-    FreeImage (TmpImage);
   }
   
+  UI_PROFILE_END (UiProfileCreateTextImage);
   return ScaledTextImage;
 }
 
@@ -1388,6 +2721,7 @@ PrintTextGraphicXY (
   }
   
   BltImageAlpha (TextImage, Xpos, Ypos, &mTransparentPixel, 16);
+  FreeImage (TextImage);
   
   if (PointerInArea) {
     DrawPointer ();
@@ -1400,9 +2734,8 @@ VOID
 PrintLabel (
   IN OC_BOOT_ENTRY   *Entries,
   IN UINTN           *VisibleList,
-  IN UINTN           VisibleIndex,
-  IN INTN            Xpos,
-  IN INTN            Ypos
+  IN UINTN           FirstIndex,
+  IN UINTN           LastIndex
   )
 {
   NDK_UI_IMAGE    *TextImage;
@@ -1412,18 +2745,18 @@ PrintLabel (
   UINTN           Needle;
   CHAR16          *String;
   UINTN           Length;
-  INTN            Rows;
-  INTN            IconsPerRow;
   INTN            NewXpos;
   INTN            NewYpos;
+  NDK_UI_GOP_CALLER Caller;
   
+  Caller = GopEnterCaller (UiGopPrintLabel);
   Length = (144 / (INTN) CHAR_WIDTH) - 2;
-  Rows = mMenuImage->Height / mIconSpaceSize;
-  IconsPerRow = mMenuImage->Width / mIconSpaceSize;
-  NewXpos = Xpos;
-  NewYpos = Ypos;
   
-  for (Index = 0; Index < VisibleIndex; ++Index) {
+  for (Index = FirstIndex; Index < LastIndex; ++Index) {
+    if (!GetIconPosition (Index, &NewXpos, &NewYpos)) {
+      continue;
+    }
+    
     if (StrLen (Entries[VisibleList[Index]].Name) > Length) {
       String = AllocateZeroPool ((Length + 1) * sizeof (CHAR16));
       StrnCpyS (String, Length + 1, Entries[VisibleList[Index]].Name, Length);
@@ -1440,17 +2773,12 @@ PrintLabel (
     }
     
     if (TextImage == NULL) {
-      return;
+      break;
     }
     
     LabelImage = CopyScaledImage (mLabelImage, (mIconSpaceSize << 4) / mLabelImage->Width);
      
     NewImage = CreateImage (LabelImage->Width, LabelImage->Height, FALSE);
-    
-    if (Index == IconsPerRow) {
-      NewXpos = Xpos;
-      NewYpos = Ypos + mIconSpaceSize + (32 * mUiScale >> 4) + ICON_ROW_SPACE_OFFSET;
-    }
      
     TakeImage (NewImage, NewXpos, NewYpos + mIconSpaceSize + 10, LabelImage->Width, LabelImage->Height);
      
@@ -1469,8 +2797,153 @@ PrintLabel (
     DrawImageArea (NewImage, 0, 0, 0, 0, NewXpos, NewYpos + mIconSpaceSize + 10);
     FreeImage (TextImage);
     FreeImage (NewImage);
-    NewXpos = NewXpos + mIconSpaceSize;
   }
+  GopLeaveCaller (Caller);
+}
+
+STATIC
+VOID
+DrawMenu (
+  IN OC_BOOT_ENTRY   *Entries,
+  IN UINTN           *VisibleList,
+  IN UINTN           IconCount
+  )
+{
+  UINTN              Row;
+  NDK_UI_GOP_CALLER  Caller;
+  
+  if (mIconAtlas == NULL) {
+    return;
+  }
+  
+  Caller = GopEnterCaller (UiGopDrawMenu);
+  ClearScreenArea (&mTransparentPixel, 0, (mScreenHeight / 2) - (mIconSpaceSize + 20), mScreenWidth, mIconSpaceSize * 3);
+  for (Row = mMenuTopRow; Row < mMenuTopRow + UI_MENU_VISIBLE_ROWS; ++Row) {
+    DrawMenuRow (IconCount, Row);
+  }
+  if (mPrintLabel) {
+    PrintLabel (Entries, VisibleList, mMenuTopRow * mIconsPerRow, IconCount);
+  }
+  GopLeaveCaller (Caller);
+}
+
+STATIC
+BOOLEAN
+IsBackgroundAreaEqual (
+  IN INTN            SourceYpos,
+  IN INTN            TargetYpos,
+  IN INTN            Xpos,
+  IN INTN            Width,
+  IN INTN            Height
+  )
+{
+  NDK_UI_IMAGE       *Source;
+  NDK_UI_IMAGE       *Target;
+  INTN               Row;
+  INTN               Rows;
+  BOOLEAN            IsEqual;
+  
+  if (Xpos < 0 || SourceYpos < 0 || TargetYpos < 0
+      || Xpos + Width > mBackground->Width
+      || SourceYpos + Height > mBackground->Height
+      || TargetYpos + Height > mBackground->Height) {
+    return FALSE;
+  }
+  
+  Source = CreateImage ((UINT16) Width, UI_TILE_SIZE, FALSE);
+  Target = CreateImage ((UINT16) Width, UI_TILE_SIZE, FALSE);
+  IsEqual = Source != NULL && Target != NULL;
+  
+  //
+  // Compare a band of tile height at a time so every tile is unpacked once.
+  //
+  for (Row = 0; IsEqual && Row < Height; Row += UI_TILE_SIZE) {
+    Rows = MIN (UI_TILE_SIZE, Height - Row);
+    CopyTiledImageArea (mBackground, Xpos, SourceYpos + Row, Width, Rows, Source->Bitmap, Width);
+    CopyTiledImageArea (mBackground, Xpos, TargetYpos + Row, Width, Rows, Target->Bitmap, Width);
+    IsEqual = CompareMem (Source->Bitmap, Target->Bitmap, Width * Rows * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)) == 0;
+  }
+  
+  FreeImage (Source);
+  FreeImage (Target);
+  return IsEqual;
+}
+
+STATIC
+BOOLEAN
+ScrollMenuToIcon (
+  IN OC_BOOT_ENTRY   *Entries,
+  IN UINTN           *VisibleList,
+  IN UINTN           IconCount,
+  IN UINTN           IconIndex
+  )
+{
+  UINTN              Row;
+  UINTN              OldTopRow;
+  UINTN              NewRow;
+  INTN               Width;
+  INTN               Xpos;
+  INTN               Ypos;
+  INTN               RowPitch;
+  INTN               BandYpos;
+  INTN               AnimatedDistance;
+  EFI_STATUS         Status;
+  NDK_UI_GOP_CALLER  Caller;
+  
+  if (mIconsPerRow == 0 || mIconAtlas == NULL) {
+    return FALSE;
+  }
+  
+  Row = IconIndex / mIconsPerRow;
+  OldTopRow = mMenuTopRow;
+  
+  if (Row < mMenuTopRow) {
+    mMenuTopRow = Row;
+  } else if (Row >= mMenuTopRow + UI_MENU_VISIBLE_ROWS) {
+    mMenuTopRow = Row - (UI_MENU_VISIBLE_ROWS - 1);
+  } else {
+    return FALSE;
+  }
+  
+  Caller = GopEnterCaller (UiGopScrollMenu);
+  LoadMenuIcons (Entries, VisibleList, IconCount);
+  
+  Width = (INTN) (mIconsPerRow * mIconSpaceSize);
+  Xpos = (mScreenWidth - Width) / 2;
+  Ypos = (mScreenHeight / 2) - mIconSpaceSize;
+  RowPitch = mIconSpaceSize + (32 * mUiScale >> 4) + ICON_ROW_SPACE_OFFSET;
+  AnimatedDistance = (mIconPaddingSize + 1) >> 1;
+  BandYpos = Ypos - AnimatedDistance;
+  
+  //
+  // Scrolling by one row keeps the rows that stay on screen and moves them with a single
+  // video to video Blt, which is only valid when the background behind both bands is identical.
+  //
+  Status = EFI_UNSUPPORTED;
+  NewRow = 0;
+  if (mPrintLabel && (mMenuTopRow == OldTopRow + 1 || mMenuTopRow + 1 == OldTopRow)
+      && IsBackgroundAreaEqual (BandYpos + RowPitch, BandYpos, Xpos, Width, RowPitch * (UI_MENU_VISIBLE_ROWS - 1))) {
+    if (mMenuTopRow > OldTopRow) {
+      Status = MoveScreenArea (Xpos, BandYpos + RowPitch, Xpos, BandYpos, Width, RowPitch * (UI_MENU_VISIBLE_ROWS - 1));
+      NewRow = UI_MENU_VISIBLE_ROWS - 1;
+    } else {
+      Status = MoveScreenArea (Xpos, BandYpos, Xpos, BandYpos + RowPitch, Width, RowPitch * (UI_MENU_VISIBLE_ROWS - 1));
+      NewRow = 0;
+    }
+  }
+  
+  if (EFI_ERROR (Status)) {
+    DrawMenu (Entries, VisibleList, IconCount);
+    GopLeaveCaller (Caller);
+    return TRUE;
+  }
+  
+  ClearScreenArea (&mTransparentPixel, Xpos, BandYpos + RowPitch * NewRow, Width, RowPitch);
+  DrawMenuRow (IconCount, mMenuTopRow + NewRow);
+  
+  PrintLabel (Entries, VisibleList, (mMenuTopRow + NewRow) * mIconsPerRow, MIN (IconCount, (mMenuTopRow + NewRow + 1) * mIconsPerRow));
+  GopLeaveCaller (Caller);
+  return TRUE;
 }
 
 STATIC
@@ -1486,7 +2959,9 @@ PrintDateTime (
   UINTN              Hour;
   CHAR16             *Str;
   INTN               Width;
+  NDK_UI_GOP_CALLER  Caller;
   
+  Caller = GopEnterCaller (UiGopDateTime);
   Str = NULL;
   Hour = 0;
   
@@ -1510,6 +2985,7 @@ PrintDateTime (
   } else {
     ClearScreenArea (&mTransparentPixel, mScreenWidth - (mScreenWidth / 5), 0, mScreenWidth / 5, ((mTextHeight * mTextScale) >> 4) * 2 + 5);
   }
+  GopLeaveCaller (Caller);
 }
 
 STATIC
@@ -1520,13 +2996,21 @@ PrintOcVersion (
   )
 {
   CHAR16                 *NewString;
+  NDK_UI_GOP_CALLER      Caller;
   
   if (String == NULL) {
     return;
   }
   
+  Caller = GopEnterCaller (UiGopPrintText);
+  
   NewString = AsciiStrCopyToUnicode (String, 0);
-  if (String != NULL && ShowAll) {
+  if (NewString == NULL) {
+    GopLeaveCaller (Caller);
+    return;
+  }
+  
+  if (ShowAll) {
     PrintTextGraphicXY (NewString, mScreenWidth, mScreenHeight);
   } else {
     ClearScreenArea (&mTransparentPixel,
@@ -1536,6 +3020,8 @@ PrintOcVersion (
                        mFontHeight * 2
                        );
   }
+  FreePool (NewString);
+  GopLeaveCaller (Caller);
 }
 
 STATIC
@@ -1545,7 +3031,9 @@ PrintTimeOutMessage (
   )
 {
   CHAR16               String[52];
+  NDK_UI_GOP_CALLER    Caller;
   
+  Caller = GopEnterCaller (UiGopTimeOut);
   if (Timeout > 0 && !mPointerIsActive) {
     UnicodeSPrint (String, sizeof (String), L"%s %02u %s.", L"The default boot selection will start in", Timeout, L"seconds");
     PrintTextGraphicXY (String, -1, (mScreenHeight / 4) * 3);
@@ -1553,9 +3041,56 @@ PrintTimeOutMessage (
     ClearScreenArea (&mTransparentPixel, 0, ((mScreenHeight / 4) * 3) - 4, mScreenWidth, mFontHeight * 2);
     Timeout = 0;
   }
+  GopLeaveCaller (Caller);
   return !(Timeout > 0);
 }
 
+STATIC
+BOOLEAN
+TimeOutMessageStep (
+  IN VOID              *Context,
+  IN UINT64            Elapsed
+  )
+{
+  UINT64               Seconds;
+  
+  Seconds = DivU64x32 (Elapsed, 1000000000);
+  if (Seconds >= mTimeOutStart) {
+    return TRUE;
+  }
+  
+  if (mTimeOutStart - (UINTN) Seconds != mTimeOutShown) {
+    mTimeOutShown = mTimeOutStart - (UINTN) Seconds;
+    PrintTimeOutMessage (mTimeOutShown);
+  }
+  return FALSE;
+}
+
+STATIC
+BOOLEAN
+UpdateTimeOutMessage (
+  IN UINTN             Timeout
+  )
+{
+  BOOLEAN              Expired;
+  
+  //
+  // While the countdown animation runs it keeps the message in step with the clock.
+  //
+  if (Timeout > 0 && !mPointerIsActive && IsAnimationActive (TimeOutMessageStep)) {
+    return FALSE;
+  }
+  
+  StopAnimation (TimeOutMessageStep, FALSE);
+  Expired = PrintTimeOutMessage (Timeout);
+  if (!Expired) {
+    mTimeOutStart = Timeout;
+    mTimeOutShown = Timeout;
+    StartAnimation (TimeOutMessageStep, NULL);
+  }
+  return Expired;
+}
+
 STATIC
 VOID
 PrintTextDescription (
@@ -1572,6 +3107,7 @@ PrintTextDescription (
   NDK_UI_IMAGE    *NewImage;
   CHAR16          Code[3];
   CHAR16          String[MaxStrWidth + 1];
+  NDK_UI_GOP_CALLER Caller;
   
   Code[0] = 0x20;
   Code[1] = OC_INPUT_STR[Selected];
@@ -1599,12 +3135,122 @@ PrintTextDescription (
     FreeImage (TextImage);
   }
 
+  Caller = GopEnterCaller (UiGopPrintText);
   BltImageAlpha (NewImage,
                  (mScreenWidth - NewImage->Width) / 2,
                  (mScreenHeight / 2) + mIconSpaceSize,
                  &mTransparentPixel,
                  16
                  );
+  GopLeaveCaller (Caller);
+  FreeImage (NewImage);
+}
+STATIC
+VOID
+ClearHud (
+  VOID
+  )
+{
+  if (mHudPlace.Width > 0) {
+    ClearScreenArea (&mTransparentPixel, mHudPlace.Xpos, mHudPlace.Ypos, mHudPlace.Width, mHudPlace.Height);
+    ZeroMem (&mHudPlace, sizeof (mHudPlace));
+  }
+}
+
+STATIC
+VOID
+UpdateHud (
+  IN BOOLEAN           Force
+  )
+{
+  NDK_UI_GOP_COUNTERS  *Frame;
+  NDK_UI_IMAGE         *TextImage;
+  NDK_UI_GOP_CALLER    Caller;
+  CHAR16               String[UI_HUD_TEXT_LENGTH];
+  UINT64               Now;
+  UINT64               FrameTime;
+  UINT64               AverageTime;
+  UINT64               PollRate;
+  BOOLEAN              NewFrame;
+  
+  if (!mHudVisible || mFontImage == NULL) {
+    return;
+  }
+  
+  Now = GetTimeInNanoSecond (GetPerformanceCounter ());
+  if (!Force && Now - mHudLastUpdate < UI_HUD_UPDATE_TIME) {
+    return;
+  }
+  
+  PollRate = mHudLastUpdate == 0 ? 0 : DivU64x64Remainder (MultU64x32 (mPointerPolls - mHudLastPolls, 1000000), MAX (DivU64x32 (Now - mHudLastUpdate, 1000), 1), NULL);
+  mHudLastUpdate = Now;
+  mHudLastPolls = mPointerPolls;
+  
+  Frame = GetGopLastFrame ();
+  FrameTime = DivU64x32 (GetTimeInNanoSecond (Frame->FrameTicks), 1000);
+  AverageTime = DivU64x32 (GetTimeInNanoSecond (GetGopAverageFrameTicks ()), 1000);
+  
+  UnicodeSPrint (String,
+                 sizeof (String),
+                 L"%lu.%u ms avg %lu.%u ms  %lu Blt %lu px  pool %u KB  poll %lu Hz",
+                 DivU64x32 (FrameTime, 1000),
+                 (UINT32) DivU64x32 (FrameTime, 100) % 10,
+                 DivU64x32 (AverageTime, 1000),
+                 (UINT32) DivU64x32 (AverageTime, 100) % 10,
+                 Frame->BltCalls,
+                 Frame->PixelsToVideo,
+                 (UINT32) (GetImageBytesInUse () / 1024),
+                 PollRate
+                 );
+  
+  //
+  // Nothing is drawn while the numbers stay the same.
+  //
+  if (!Force && StrCmp (String, mHudText) == 0) {
+    return;
+  }
+  StrCpyS (mHudText, UI_HUD_TEXT_LENGTH, String);
+  
+  TextImage = CreateTextImage (String);
+  if (TextImage == NULL) {
+    return;
+  }
+  
+  Caller = GopEnterCaller (UiGopHud);
+  NewFrame = UiBeginFrame ();
+  ClearHud ();
+  BltImageAlpha (TextImage, 8, 5, &mTransparentPixel, 16);
+  mHudPlace.Xpos = 8;
+  mHudPlace.Ypos = 5;
+  mHudPlace.Width = MIN (TextImage->Width, mScreenWidth - 8);
+  mHudPlace.Height = MIN (TextImage->Height, mScreenHeight - 5);
+  FreeImage (TextImage);
+  if (NewFrame) {
+    UiEndFrame ();
+  }
+  GopLeaveCaller (Caller);
+}
+
+STATIC
+VOID
+ToggleHud (
+  VOID
+  )
+{
+  NDK_UI_GOP_CALLER    Caller;
+  
+  mHudVisible = !mHudVisible;
+  mHudLastUpdate = 0;
+  mHudText[0] = L'\0';
+  
+  if (mHudVisible) {
+    UpdateHud (TRUE);
+    return;
+  }
+  
+  Caller = GopEnterCaller (UiGopHud);
+  ClearHud ();
+  GopLeaveCaller (Caller);
 }
 /* Mouse Functions Begin */
 
@@ -1613,9 +3259,27 @@ HidePointer (
   VOID
   )
 {
-  if (mPointer.SimplePointerProtocol != NULL && mPointerIsActive) {
+  NDK_UI_GOP_CALLER  Caller;
+  
+  if (mPointer.SimplePointerProtocol == NULL || !mPointerIsActive) {
+    return;
+  }
+  
+  Caller = GopEnterCaller (UiGopPointer);
+  if (mSceneImage == NULL) {
     DrawImageArea (mPointer.OldImage, 0, 0, 0, 0, mPointer.OldPlace.Xpos, mPointer.OldPlace.Ypos);
+    GopLeaveCaller (Caller);
+    return;
+  }
+  
+  if (mPointerVisible) {
+    mPointerVisible = FALSE;
+    AddDamage (mPointer.OldPlace.Xpos, mPointer.OldPlace.Ypos, POINTER_WIDTH, POINTER_HEIGHT);
+    if (!mFrameOpen) {
+      PresentScene ();
+    }
   }
+  GopLeaveCaller (Caller);
 }
 
 VOID
@@ -1623,9 +3287,27 @@ DrawPointer (
   VOID
   )
 {
+  NDK_UI_GOP_CALLER  Caller;
+  
   if (mPointer.SimplePointerProtocol == NULL || !mPointerIsActive) {
     return;
   }
+  
+  Caller = GopEnterCaller (UiGopPointer);
+  if (mSceneImage != NULL) {
+    if (mPointerVisible && (mPointer.OldPlace.Xpos != mPointer.NewPlace.Xpos || mPointer.OldPlace.Ypos != mPointer.NewPlace.Ypos)) {
+      AddDamage (mPointer.OldPlace.Xpos, mPointer.OldPlace.Ypos, POINTER_WIDTH, POINTER_HEIGHT);
+    }
+    CopyMem (&mPointer.OldPlace, &mPointer.NewPlace, sizeof(AREA_RECT));
+    mPointerVisible = TRUE;
+    mPointerDirty = TRUE;
+    if (!mFrameOpen) {
+      PresentScene ();
+    }
+    GopLeaveCaller (Caller);
+    return;
+  }
+  
   TakeImage (mPointer.OldImage,
              mPointer.NewPlace.Xpos,
              mPointer.NewPlace.Ypos,
@@ -1656,6 +3338,7 @@ DrawPointer (
                  mPointer.OldPlace.Xpos,
                  mPointer.OldPlace.Ypos
                  );
+  GopLeaveCaller (Caller);
 }
 
 VOID
@@ -1663,12 +3346,18 @@ RedrawPointer (
   VOID
   )
 {
+  BOOLEAN             NewFrame;
+  
   if (mPointer.SimplePointerProtocol == NULL) {
    return;
   }
   
+  NewFrame = UiBeginFrame ();
   HidePointer ();
   DrawPointer ();
+  if (NewFrame) {
+    UiEndFrame ();
+  }
 }
 
 EFI_STATUS
@@ -1678,6 +3367,7 @@ InitMouse (
 {
   EFI_STATUS          Status;
   CONST CHAR16        *FilePath;
+  CONST CHAR16        *Fallback;
   UINTN               DataSize;
   
   Status = EFI_UNSUPPORTED;
@@ -1701,14 +3391,16 @@ InitMouse (
     return Status;
   }
   
+  Fallback = NULL;
   if (mUiScale == 28 || mScreenHeight >= 2160) {
     FilePath = UI_IMAGE_POINTER;
+    Fallback = UI_IMAGE_POINTER_ALT;
   } else {
     FilePath = UI_IMAGE_POINTER_ALT;
   }
   
   if (FileExist (FilePath)) {
-    mPointer.Pointer = DecodePNGFile (FilePath);
+    mPointer.Pointer = DecodePNGFileOrFallback (FilePath, Fallback);
   } else {
     mPointer.Pointer = CreateFilledImage (POINTER_WIDTH, POINTER_HEIGHT, TRUE, &mBluePixel);
   }
@@ -1769,6 +3461,7 @@ PointerUpdate (
   INTN                      ScreenRelX;
   INTN                      ScreenRelY;
   
+  ++mPointerPolls;
   Now = GetTimeInNanoSecond (GetPerformanceCounter ());
   Status = mPointer.SimplePointerProtocol->GetState (mPointer.SimplePointerProtocol, &tmpState);
   if (!EFI_ERROR (Status)) {
@@ -1858,6 +3551,66 @@ IsMouseInPlace (
   return  MouseInRect (&Place);
 }
 
+STATIC
+VOID
+BakeToolBarTiles (
+  IN OUT NDK_UI_ICON  *Button,
+  IN     NDK_UI_IMAGE *LabelImage,
+  IN     INTN         IconScale
+  )
+{
+  NDK_UI_IMAGE        *NewImage;
+  UINTN               Tile;
+  INTN                LabelXpos;
+  INTN                LabelYpos;
+  INTN                Width;
+  INTN                Height;
+  
+  LabelXpos = 0;
+  LabelYpos = Button->Image->Height - IconScale;
+  Width = Button->Image->Width;
+  Height = Button->Image->Height;
+  
+  if (LabelImage != NULL) {
+    LabelXpos = ABS ((Button->Image->Width - LabelImage->Width) >> 1);
+    Width = MAX (Width, LabelXpos + LabelImage->Width);
+    Height = MAX (Height, LabelYpos + LabelImage->Height);
+  }
+  
+  Width = MIN (Width, mBackground->Width - Button->Xpos);
+  Height = MIN (Height, mBackground->Height - Button->Ypos);
+  
+  //
+  // A tile covers the button and its label, the action fires on selection so there is no pressed state.
+  //
+  for (Tile = UiTileNormal; Tile <= UiTileSelected; ++Tile) {
+    FreeImage (Button->Tiles[Tile]);
+    Button->Tiles[Tile] = NULL;
+    
+    NewImage = CreateImage ((UINT16) Width, (UINT16) Height, FALSE);
+    if (NewImage == NULL) {
+      continue;
+    }
+    
+    CopyTiledImageArea (mBackground,
+                        Button->Xpos,
+                        Button->Ypos,
+                        Width,
+                        Height,
+                        NewImage->Bitmap,
+                        Width
+                        );
+    
+    ComposeImage (NewImage, Button->Image, 0, 0);
+    ComposeImage (NewImage, LabelImage, LabelXpos, LabelYpos);
+    if (Tile == UiTileSelected) {
+      ComposeImage (NewImage, mIconReset.Selector, 0, 0);
+    }
+    
+    Button->Tiles[Tile] = NewImage;
+  }
+}
+
 VOID
 CreateToolBar (
   IN BOOLEAN          Initialize
@@ -1866,7 +3619,7 @@ CreateToolBar (
   NDK_UI_IMAGE        *LabelImage;
   NDK_UI_IMAGE        *Icon;
   INTN                IconScale;
-  INTN                Offset;
+  NDK_UI_GOP_CALLER   Caller;
   
   IconScale = 16;
   if (mScreenHeight < 2160) {
@@ -1877,25 +3630,25 @@ CreateToolBar (
   
   if (Initialize) {
     if (mIconReset.Image == NULL && FileExist (UI_ICON_RESET)) {
-      Icon = DecodePNGFile (UI_ICON_RESET);
-      mIconReset.Image = CopyScaledImage (Icon,IconScale);
-      FreeImage (Icon);
+      Icon = LoadAsset (UI_ICON_RESET);
+      mIconReset.Image = CopyScaledAsset (Icon, IconScale);
+      ReleaseAsset (Icon);
     } else {
       mIconReset.Image = CreateFilledImage (80, 80, TRUE, &mBluePixel);
     }
     
     if (mIconReset.Selector == NULL && FileExist (UI_IMAGE_SELECTOR_FUNC)) {
-      Icon = DecodePNGFile (UI_IMAGE_SELECTOR_FUNC);
-      mIconReset.Selector = CopyScaledImage (Icon, IconScale);
-      FreeImage (Icon);
+      Icon = LoadAsset (UI_IMAGE_SELECTOR_FUNC);
+      mIconReset.Selector = CopyScaledAsset (Icon, IconScale);
+      ReleaseAsset (Icon);
     } else {
       mIconReset.Selector = mIconReset.Image;
     }
     
     if (mIconShutdown.Image == NULL && FileExist (UI_ICON_SHUTDOWN)) {
-      Icon = DecodePNGFile (UI_ICON_SHUTDOWN);
-      mIconShutdown.Image = CopyScaledImage (Icon, IconScale);
-      FreeImage (Icon);
+      Icon = LoadAsset (UI_ICON_SHUTDOWN);
+      mIconShutdown.Image = CopyScaledAsset (Icon, IconScale);
+      ReleaseAsset (Icon);
     } else {
       mIconShutdown.Image = mIconReset.Image;
     }
@@ -1907,27 +3660,34 @@ CreateToolBar (
     mIconShutdown.Xpos = mScreenWidth / 2 + (mIconShutdown.Image->Width >> 2);
     mIconShutdown.Ypos = mIconReset.Ypos;
     mIconShutdown.Action = SystemReset;
+    
+    LabelImage = CreateTextImage (UI_MENU_SYSTEM_RESET);
+    BakeToolBarTiles (&mIconReset, LabelImage, IconScale);
+    FreeImage (LabelImage);
+    
+    LabelImage = CreateTextImage (UI_MENU_SYSTEM_SHUTDOWN);
+    BakeToolBarTiles (&mIconShutdown, LabelImage, IconScale);
+    FreeImage (LabelImage);
   }
 
-  BltMenuImage (mIconReset.Image, mIconReset.Xpos, mIconReset.Ypos);
-  BltMenuImage (mIconShutdown.Image, mIconShutdown.Xpos, mIconShutdown.Ypos);
-  LabelImage = CreateTextImage (UI_MENU_SYSTEM_RESET);
-  Offset = (mIconReset.Image->Width - LabelImage->Width) >> 1;
-  BltImageAlpha (LabelImage,
-                 mIconReset.Xpos + ABS (Offset),
-                 mIconReset.Ypos + mIconReset.Image->Height - IconScale,
-                 &mTransparentPixel,
-                 16
-                 );
+  Caller = GopEnterCaller (UiGopToolBar);
+  BltImage (mIconReset.Tiles[UiTileNormal], mIconReset.Xpos, mIconReset.Ypos);
+  BltImage (mIconShutdown.Tiles[UiTileNormal], mIconShutdown.Xpos, mIconShutdown.Ypos);
+  GopLeaveCaller (Caller);
+}
+
+STATIC
+VOID
+FreeToolBarTiles (
+  IN OUT NDK_UI_ICON  *Button
+  )
+{
+  UINTN               Tile;
   
-  LabelImage = CreateTextImage (UI_MENU_SYSTEM_SHUTDOWN);
-  Offset = (mIconShutdown.Image->Width - LabelImage->Width) >> 1;
-  BltImageAlpha (LabelImage,
-                 mIconShutdown.Xpos + ABS (Offset),
-                 mIconShutdown.Ypos + mIconShutdown.Image->Height - IconScale,
-                 &mTransparentPixel,
-                 16
-                 );
+  for (Tile = 0; Tile < UiTileMax; ++Tile) {
+    FreeImage (Button->Tiles[Tile]);
+    Button->Tiles[Tile] = NULL;
+  }
 }
 
 VOID
@@ -1935,13 +3695,19 @@ FreeToolBar (
   VOID
   )
 {
+  FreeToolBarTiles (&mIconReset);
+  FreeToolBarTiles (&mIconShutdown);
+  if (mIconShutdown.Image != mIconReset.Image) {
+    FreeImage (mIconShutdown.Image);
+  }
+  if (mIconReset.Selector != mIconReset.Image) {
+    FreeImage (mIconReset.Selector);
+  }
   FreeImage (mIconReset.Image);
   mIconReset.Image = NULL;
   mIconReset.IsSelected = FALSE;
-  FreeImage (mIconReset.Selector);
   mIconReset.Selector = NULL;
   mIconReset.Action = NULL;
-  FreeImage (mIconShutdown.Image);
   mIconShutdown.IsSelected = FALSE;
   mIconShutdown.Image = NULL;
   mIconShutdown.Action = NULL;
@@ -1952,38 +3718,13 @@ SelectResetFunc (
   VOID
   )
 {
-  NDK_UI_IMAGE        *NewImage;
+  NDK_UI_GOP_CALLER   Caller;
   
   HidePointer ();
-  CreateToolBar (FALSE);
-  if (!mIconReset.IsSelected && !mIconShutdown.IsSelected) {
-    DrawPointer ();
-    return;
-  }
-  
-  NewImage = CreateImage (mIconReset.Image->Width, mIconReset.Image->Height, FALSE);
-  
-  if (mIconReset.IsSelected) {
-    TakeImage (NewImage, mIconReset.Xpos, mIconReset.Ypos, NewImage->Width, NewImage->Height);
-  } else if (mIconShutdown.IsSelected) {
-    TakeImage (NewImage, mIconShutdown.Xpos, mIconShutdown.Ypos, NewImage->Width, NewImage->Height);
-  }
-  
-  RawCompose (NewImage->Bitmap,
-              mIconReset.Selector->Bitmap,
-              NewImage->Width,
-              NewImage->Height,
-              NewImage->Width,
-              mIconReset.Selector->Width
-              );
-  
-  if (mIconReset.IsSelected) {
-    BltImage (NewImage, mIconReset.Xpos, mIconReset.Ypos);
-  } else if (mIconShutdown.IsSelected) {
-    BltImage (NewImage, mIconShutdown.Xpos, mIconShutdown.Ypos);
-  }
-  
-  FreeImage (NewImage);
+  Caller = GopEnterCaller (UiGopToolBar);
+  BltImage (mIconReset.Tiles[mIconReset.IsSelected ? UiTileSelected : UiTileNormal], mIconReset.Xpos, mIconReset.Ypos);
+  BltImage (mIconShutdown.Tiles[mIconShutdown.IsSelected ? UiTileSelected : UiTileNormal], mIconShutdown.Xpos, mIconShutdown.Ypos);
+  GopLeaveCaller (Caller);
   DrawPointer ();
 }
 
@@ -1993,46 +3734,29 @@ CheckIconClick (
   VOID
   )
 {
-  INTN       IconsPerRow;
-  INTN       Rows;
-  INTN       Xpos;
-  INTN       Ypos;
-  INTN       NewXpos;
-  INTN       NewYpos;
   INTN       Result;
   UINTN      Index;
   AREA_RECT  Place;
   
   Result = -1;
   
-  if (mMenuImage == NULL) {
+  if (mIconAtlas == NULL) {
     return Result;
   }
   
   Place.Width = mIconSpaceSize;
   Place.Height = mIconSpaceSize;
-  
-  Rows = mMenuImage->Height / mIconSpaceSize;
-  IconsPerRow = mMenuImage->Width / mIconSpaceSize;
-  Xpos = (mScreenWidth - mMenuImage->Width) / 2;
-  Ypos = (mScreenHeight / 2) - mIconSpaceSize;
-  NewXpos = Xpos;
-  NewYpos = Ypos;
   mPointer.IsClickable = FALSE;
   
-  for (Index = 0; Index < mMenuIconsCount; ++Index) {
-    Place.Xpos = NewXpos;
-    Place.Ypos = NewYpos;
+  for (Index = mMenuTopRow * mIconsPerRow; Index < mMenuIconsCount; ++Index) {
+    if (!GetIconPosition (Index, &Place.Xpos, &Place.Ypos)) {
+      break;
+    }
     if (MouseInRect (&Place)) {
       mPointer.IsClickable = TRUE;
       Result = (INTN) Index;
       break;
     }
-    NewXpos = NewXpos + mIconSpaceSize;
-    if (Index == (IconsPerRow - 1)) {
-      NewXpos = Xpos;
-      NewYpos = Ypos + mIconSpaceSize + (32 * mUiScale >> 4) + ICON_ROW_SPACE_OFFSET;
-    }
   }
   
   Place.Width = mIconReset.Image->Width;
@@ -2099,6 +3823,7 @@ KillMouse (
   mPointer.MouseEvent = NoEvents;
   mPointer.SimplePointerProtocol = NULL;
   mPointerIsActive = FALSE;
+  mPointerVisible = FALSE;
 }
 
 /* Mouse Functions End*/
@@ -2147,8 +3872,15 @@ OcWaitForKeyIndex (
   }
 
   while (Timeout == 0 || CurrTime == 0 || CurrTime < EndTime) {
+    AnimationTick ();
+    UpdateHud (FALSE);
+    
     if (mPointer.SimplePointerProtocol != NULL) {
       PointerUpdate();
+      if (mPointer.MouseEvent != NoEvents) {
+        mInputTicks = GetPerformanceCounter ();
+        mInputFromPointer = TRUE;
+      }
       switch (mPointer.MouseEvent) {
         case DoubleClick:
         case LeftClick:
@@ -2205,6 +3937,11 @@ OcWaitForKeyIndex (
       return OC_INPUT_INVALID;
     }
 
+    if (NumKeys != 0) {
+      mInputTicks = GetPerformanceCounter ();
+      mInputFromPointer = FALSE;
+    }
+    
     CurrTime    = GetTimeInNanoSecond (GetPerformanceCounter ());
     HasCommand = (Modifiers & (APPLE_MODIFIER_LEFT_COMMAND | APPLE_MODIFIER_RIGHT_COMMAND)) != 0;
 
@@ -2461,17 +4198,53 @@ SystemReset (
   gRT->ResetSystem (ResetType, EFI_SUCCESS, 0, NULL);
 }
 
+STATIC
+NDK_UI_INPUT_EVENT
+ClassifyInput (
+  IN INTN                 KeyIndex
+  )
+{
+  if (KeyIndex == OC_INPUT_TIMEOUT || KeyIndex == OC_INPUT_INVALID) {
+    return UiInputEventMax;
+  }
+  
+  if (mInputFromPointer) {
+    return (KeyIndex == OC_INPUT_POINTER || KeyIndex == OC_INPUT_TAB) ? UiInputHover : UiInputClick;
+  }
+  
+  switch (KeyIndex) {
+    case OC_INPUT_UP:
+    case OC_INPUT_DOWN:
+    case OC_INPUT_LEFT:
+    case OC_INPUT_RIGHT:
+    case OC_INPUT_TOP:
+    case OC_INPUT_BOTTOM:
+      return UiInputArrow;
+    case OC_INPUT_TAB:
+    case OC_INPUT_MENU:
+      return UiInputTab;
+    default:
+      return KeyIndex >= 0 ? UiInputIndex : UiInputEventMax;
+  }
+}
+
 STATIC
 VOID
 RestoreConsoleMode (
   IN OC_PICKER_CONTEXT    *Context
   )
 {
-  FreeImage (mBackgroundImage);
-  FreeImage (mMenuImage);
-  mMenuImage = NULL;
+  FreeAnimation ();
+  UiEndFrame ();
+  mPointerVisible = FALSE;
+  mHudVisible = FALSE;
+  ZeroMem (&mHudPlace, sizeof (mHudPlace));
+  FreeTiledImage (mBackground);
+  mBackground = NULL;
+  FreeMenuIcons ();
   FreeImage (mFontImage);
   mFontImage = NULL;
+  FreeMipChain (&mSelectionMips);
   FreeImage (mSelectionImage);
   mSelectionImage = NULL;
   FreeImage (mLabelImage);
@@ -2485,6 +4258,22 @@ RestoreConsoleMode (
   }
   gST->ConOut->SetCursorPosition (gST->ConOut, 0, 0);
   KillMouse ();
+  SaveGopStats ();
+  SaveLatency ();
+  SaveProfile ();
+  FreeFrameBuffer ();
+  FreeImage (mSceneImage);
+  mSceneImage = NULL;
+  SaveIconCache ();
+  FreeIconCache ();
+  ReleaseAssetLoader ();
+  FreeAssetCache ();
+  FreeImageSlabs ();
+  if (IsVirtualDisplay (mGraphicsOutput)) {
+    FreeVirtualDisplay ();
+    mGraphicsOutput = NULL;
+  }
+  SaveAllocations ();
 }
 
 EFI_STATUS
@@ -2513,6 +4302,7 @@ UiMenuMain (
   OC_STORAGE_CONTEXT                 *Storage;
   BOOLEAN                            PlayedOnce;
   BOOLEAN                            PlayChosen;
+  BOOLEAN                            FirstFrame;
   
   Selected         = 0;
   VisibleIndex     = 0;
@@ -2526,6 +4316,7 @@ UiMenuMain (
   CustomEntryIndex = 0;
   PlayedOnce       = FALSE;
   PlayChosen       = FALSE;
+  FirstFrame       = TRUE;
   
   if (Storage->FileSystem != NULL && mFileSystem == NULL) {
     mFileSystem = Storage->FileSystem;
@@ -2548,13 +4339,23 @@ UiMenuMain (
   }
   
   InitScreen ();
+  TimelineMark ("InitScreen", NULL);
+  InitAnimation ();
+  ResetGopStats ();
+  ResetLatency ();
+  InitMemoryBudget ();
+  PreloadAssets (BootEntries, Count);
+  TimelineMark ("PreloadAssets", NULL);
   ClearScreen (&mTransparentPixel);
+  TimelineMark ("ClearScreen", NULL);
   PrepareFont ();
+  TimelineMark ("PrepareFont", NULL);
+  PrepareImageSlabs ();
   CreateToolBar (TRUE);
+  TimelineMark ("CreateToolBar", NULL);
   
   while (TRUE) {
-    FreeImage (mMenuImage);
-    mMenuImage = NULL;
+    UiBeginFrame ();
     for (Index = 0, VisibleIndex = 0; Index < MIN (Count, OC_INPUT_MAX); ++Index) {
       if ((BootEntries[Index].Type == OC_BOOT_APPLE_RECOVERY && !ShowAll)
           || (BootEntries[Index].Type == OC_BOOT_APPLE_TIME_MACHINE && !ShowAll)
@@ -2567,20 +4368,14 @@ UiMenuMain (
         Selected = VisibleIndex;
       }
       VisibleList[VisibleIndex] = Index;
-      CreateIcon (BootEntries[Index].Name,
-                  BootEntries[Index].Type,
-                  VisibleIndex,
-                  BootEntries[Index].IsExternal,
-                  BootEntries[Index].IsFolder
-                  );
       ++VisibleIndex;
     }
     
-    ClearScreenArea (&mTransparentPixel, 0, (mScreenHeight / 2) - (mIconSpaceSize + 20), mScreenWidth, mIconSpaceSize * 3);
-    BltMenuImage (mMenuImage, (mScreenWidth - mMenuImage->Width) / 2, (mScreenHeight / 2) - mIconSpaceSize);
-    if (mPrintLabel) {
-      PrintLabel (BootEntries, VisibleList, VisibleIndex, (mScreenWidth - mMenuImage->Width) / 2, (mScreenHeight / 2) - mIconSpaceSize);
+    CreateMenu (BootEntries, VisibleList, VisibleIndex, Selected);
+    if (FirstFrame && StartAnimation (MenuFadeStep, NULL)) {
+      mMenuColorDiff = ICON_BRIGHTNESS_OFF;
     }
+    DrawMenu (BootEntries, VisibleList, VisibleIndex);
     
     PrintTextDescription (MaxStrWidth,
                           Selected,
@@ -2594,7 +4389,7 @@ UiMenuMain (
     PrintOcVersion (Context->TitleSuffix, ShowAll);
     PrintDateTime (ShowAll);
     if (!TimeoutExpired) {
-      TimeoutExpired = PrintTimeOutMessage (TimeOutSeconds);
+      TimeoutExpired = UpdateTimeOutMessage (TimeOutSeconds);
       TimeOutSeconds = TimeoutExpired ? 10000 : TimeOutSeconds;
     }
     
@@ -2624,8 +4419,16 @@ UiMenuMain (
       PlayedOnce = TRUE;
     }
     
+    UiEndFrame ();
+    if (FirstFrame) {
+      TimelineMark ("FirstFrame", NULL);
+      FirstFrame = FALSE;
+    }
+    
     while (TRUE) {
       KeyIndex = OcWaitForKeyIndex (Context, KeyMap, 1000, Context->PollAppleHotKeys, &SetDefault);
+      UiBeginFrame ();
+      LatencyBegin (ClassifyInput (KeyIndex), mInputTicks);
       if (PlayChosen && KeyIndex == OC_INPUT_TIMEOUT) {
         OcPlayAudioFile (Context, OcVoiceOverAudioFileSelected, FALSE);
         OcPlayAudioEntry (Context, &BootEntries[DefaultEntry], 1 + (UINT32) Selected);
@@ -2640,6 +4443,7 @@ UiMenuMain (
         }
         SwitchIconSelection (VisibleIndex, Selected, TRUE, TRUE);
         *ChosenBootEntry = &BootEntries[DefaultEntry];
+        TimelineMark ("UserChoice", (*ChosenBootEntry)->Name);
         SetDefault = BootEntries[DefaultEntry].DevicePath != NULL
           && !BootEntries[DefaultEntry].IsAuxiliary
           && Context->AllowSetDefault
@@ -2660,6 +4464,9 @@ UiMenuMain (
       } else if (KeyIndex == OC_INPUT_FUNCTIONAL(10)) {
         TimeOutSeconds = 0;
         TakeScreenShot (L"ScreenShot");
+      } else if (KeyIndex == OC_INPUT_FUNCTIONAL(11)) {
+        TimeOutSeconds = 0;
+        ToggleHud ();
       } else if (KeyIndex == OC_INPUT_MORE && !mIconReset.IsSelected && !mIconShutdown.IsSelected) {
         HidePointer ();
         ShowAll = !ShowAll;
@@ -2690,6 +4497,7 @@ UiMenuMain (
         DefaultEntry = Selected > 0 ? VisibleList[Selected - 1] : VisibleList[VisibleIndex - 1];
         Selected = Selected > 0 ? --Selected : VisibleIndex - 1;
         mCurrentSelection = Selected;
+        ScrollMenuToIcon (BootEntries, VisibleList, VisibleIndex, Selected);
         SwitchIconSelection (VisibleIndex, Selected, TRUE, FALSE);
         PrintTextDescription (MaxStrWidth,
                               Selected,
@@ -2705,6 +4513,7 @@ UiMenuMain (
         DefaultEntry = Selected < (VisibleIndex - 1) ? VisibleList[Selected + 1] : VisibleList[0];
         Selected = Selected < (VisibleIndex - 1) ? ++Selected : 0;
         mCurrentSelection = Selected;
+        ScrollMenuToIcon (BootEntries, VisibleList, VisibleIndex, Selected);
         SwitchIconSelection (VisibleIndex, Selected, TRUE, FALSE);
         PrintTextDescription (MaxStrWidth,
                               Selected,
@@ -2730,6 +4539,7 @@ UiMenuMain (
         ASSERT (KeyIndex >= 0);
         SwitchIconSelection (VisibleIndex, Selected, TRUE, TRUE);
         *ChosenBootEntry = &BootEntries[VisibleList[KeyIndex]];
+        TimelineMark ("UserChoice", (*ChosenBootEntry)->Name);
         SetDefault = BootEntries[VisibleList[KeyIndex]].DevicePath != NULL
           && !BootEntries[VisibleList[KeyIndex]].IsAuxiliary
           && Context->AllowSetDefault
@@ -2753,11 +4563,12 @@ UiMenuMain (
 
       if (!TimeoutExpired) {
         PrintDateTime (ShowAll);
-        TimeoutExpired = PrintTimeOutMessage (TimeOutSeconds);
+        TimeoutExpired = UpdateTimeOutMessage (TimeOutSeconds);
         TimeOutSeconds = TimeoutExpired ? 10000 : TimeOutSeconds;
       } else {
         PrintDateTime (ShowAll);
       }
+      UiEndFrame ();
     }
   }
 
@@ -2791,6 +4602,10 @@ RunBootPicker (
 
   SaidWelcome  = FALSE;
   
+  ResetTimeline ();
+  ResetProfile ();
+  TimelineMark ("RunBootPicker", NULL);
+  
   mHideAuxiliary = Context->HideAuxiliary;
   
   AppleBootPolicy = OcAppleBootPolicyInstallProtocol (FALSE);
@@ -2842,6 +4657,7 @@ RunBootPicker (
       NULL,
       TRUE
       );
+    TimelineMark ("OcScanForBootEntries", NULL);
 
     if (EFI_ERROR (Status)) {
       DEBUG ((DEBUG_ERROR, "OCUI: OcScanForBootEntries failure - %r\n", Status));
@@ -2887,6 +4703,7 @@ RunBootPicker (
     } else {
       Chosen = &Entries[DefaultEntry];
       Status = EFI_SUCCESS;
+      TimelineMark ("UserChoice", Chosen->Name);
     }
 
     if (EFI_ERROR (Status)) {
@@ -2923,6 +4740,8 @@ RunBootPicker (
             );
         }
       }
+      TimelineMark ("OcLoadBootEntry", Chosen->Name);
+      SaveTimeline ();
       Status = OcLoadBootEntry (
         AppleBootPolicy,
         Context,
@@ -16,6 +16,7 @@
 #include <Protocol/OcInterface.h>
 #include <Protocol/AppleKeyMapAggregator.h>
 #include <Protocol/SimplePointer.h>
+#include <Protocol/MpService.h>
 
 #include <IndustryStandard/AppleCsrConfig.h>
 
@@ -55,6 +56,8 @@
 #define UI_IMAGE_LABEL_OFF            L"EFI\\OC\\Icons\\no_label.png"
 #define UI_IMAGE_TEXT_SCALE_OFF       L"EFI\\OC\\Icons\\No_text_scaling.png"
 #define UI_IMAGE_ICON_SCALE_OFF       L"EFI\\OC\\Icons\\No_icon_scaling.png"
+#define UI_IMAGE_FRAMEBUFFER_ON       L"EFI\\OC\\Icons\\Direct_framebuffer.png"
+#define UI_IMAGE_VIRTUAL_DISPLAY_ON   L"EFI\\OC\\Icons\\Virtual_display.png"
 
 
 #define UI_ICON_WIN                   L"EFI\\OC\\Icons\\os_win.icns"
@@ -83,8 +86,14 @@
 #define UI_MENU_SYSTEM_RESET          L"Restart"
 #define UI_MENU_SYSTEM_SHUTDOWN       L"Shutdown"
 #define UI_MENU_POINTER_SPEED         L"PointerSpeed"
+#define UI_MENU_VIRTUAL_DISPLAY       L"UIVirtualDisplay"
+#define UI_MENU_MEMORY_BUDGET         L"UIMemoryBudget"
 #define UI_INPUT_SYSTEM_RESET         99
 #define UI_INPUT_SYSTEM_SHUTDOWN      100
+#define UI_MENU_VISIBLE_ROWS          2
+#define UI_DAMAGE_MAX                 16
+#define UI_HUD_UPDATE_TIME            250000000ULL
+#define UI_HUD_TEXT_LENGTH            96
 
 /*========== Image ==========*/
 
@@ -101,6 +110,25 @@ typedef struct _NDK_UI_IMAGE {
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL   *Bitmap;
 } NDK_UI_IMAGE;
 
+//
+// Same sized images packed into one page aligned column of slots, Rects locate them in Image.
+//
+typedef struct _NDK_UI_ATLAS {
+  NDK_UI_IMAGE                    Image;
+  UINTN                           Pages;
+  UINT16                          SlotWidth;
+  UINT16                          SlotHeight;
+  UINTN                           SlotCount;
+  BOOLEAN                         SlotUsed[OC_INPUT_MAX];
+} NDK_UI_ATLAS;
+
+typedef enum {
+  UiTileNormal,
+  UiTileSelected,
+  UiTilePressed,
+  UiTileMax
+} NDK_UI_TILE;
+
 typedef struct _NDK_UI_ICON {
   INTN                            Xpos;
   INTN                            Ypos;
@@ -108,6 +136,7 @@ typedef struct _NDK_UI_ICON {
   NDK_ICON_ACTION                 Action;
   NDK_UI_IMAGE                    *Image;
   NDK_UI_IMAGE                    *Selector;
+  NDK_UI_IMAGE                    *Tiles[UiTileMax];
 } NDK_UI_ICON;
 
 /*========== Pointer ==========*/
@@ -160,7 +189,41 @@ typedef struct _pointers {
 
 #define ICON_BRIGHTNESS_LEVEL   80
 #define ICON_BRIGHTNESS_FULL    0
+#define ICON_BRIGHTNESS_OFF     -255
 #define ICON_ROW_SPACE_OFFSET   20
+#define UI_MIP_LEVELS           3
+
+typedef struct {
+  NDK_UI_IMAGE                    *Levels[UI_MIP_LEVELS];
+} NDK_UI_MIP_CHAIN;
+
+//
+// Blend descriptor for ComposeImageEx, each combination of flags has its own kernel.
+//
+#define UI_BLEND_SRC_ALPHA      BIT0
+#define UI_BLEND_DST_ALPHA      BIT1
+#define UI_BLEND_OPACITY        BIT2
+#define UI_BLEND_COLOR          BIT3
+#define UI_BLEND_PREMULTIPLIED  BIT4
+#define UI_BLEND_KERNELS        32
+
+typedef struct {
+  UINT32                          Flags;
+  INTN                            Opacity;
+  INTN                            ColorDiff;
+} NDK_UI_BLEND;
+
+typedef
+VOID
+(*NDK_UI_COMPOSE_KERNEL) (
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *CompBasePtr,
+  IN     EFI_GRAPHICS_OUTPUT_BLT_PIXEL *TopBasePtr,
+  IN     INTN                          Width,
+  IN     INTN                          Height,
+  IN     INTN                          CompLineOffset,
+  IN     INTN                          TopLineOffset,
+  IN     CONST NDK_UI_BLEND            *Blend
+  );
 
 NDK_UI_IMAGE *
 CreateImage (
@@ -182,18 +245,89 @@ CopyImage (
   IN NDK_UI_IMAGE   *Image
   );
 
+VOID
+ScaleImageArea (
+  IN OUT NDK_UI_IMAGE      *DestImage,
+  IN     INTN              DestX,
+  IN     INTN              DestY,
+  IN     NDK_UI_IMAGE      *SrcImage,
+  IN     INTN              Ratio,
+  IN     INTN              ScaledX,
+  IN     INTN              ScaledY,
+  IN     INTN              Width,
+  IN     INTN              Height
+  );
+
 NDK_UI_IMAGE *
 CopyScaledImage (
   IN NDK_UI_IMAGE      *OldImage,
   IN INTN              Ratio
   );
 
+VOID
+AllocateMipChain (
+  IN  NDK_UI_IMAGE      *Image,
+  OUT NDK_UI_MIP_CHAIN  *Chain
+  );
+
+VOID
+FillMipChain (
+  IN OUT NDK_UI_MIP_CHAIN  *Chain
+  );
+
+VOID
+BuildMipChain (
+  IN  NDK_UI_IMAGE      *Image,
+  OUT NDK_UI_MIP_CHAIN  *Chain
+  );
+
+VOID
+FreeMipChain (
+  IN OUT NDK_UI_MIP_CHAIN  *Chain
+  );
+
+NDK_UI_IMAGE *
+CopyMipImage (
+  IN NDK_UI_MIP_CHAIN  *Chain,
+  IN INTN              Ratio
+  );
+
+VOID
+ScaleComposeArea (
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *DestPtr,
+  IN     INTN                          DestLineOffset,
+  IN     EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Fill OPTIONAL,
+  IN     NDK_UI_IMAGE                  *SrcImage OPTIONAL,
+  IN     INTN                          Ratio,
+  IN     INTN                          Width,
+  IN     INTN                          Height
+  );
+
+VOID
+SwizzleImage (
+  IN OUT NDK_UI_IMAGE              *Image
+  );
+
+NDK_UI_IMAGE *
+DecodePNGRgba (
+  IN VOID                          *Buffer,
+  IN UINT32                        BufferSize
+  );
+
 NDK_UI_IMAGE *
 DecodePNG (
   IN VOID                          *Buffer,
   IN UINT32                        BufferSize
   );
 
+EFI_STATUS
+GetPngDimensions (
+  IN  VOID                         *Buffer,
+  IN  UINT32                       BufferSize,
+  OUT UINT32                       *Width,
+  OUT UINT32                       *Height
+  );
+
 VOID
 BltImage (
   IN NDK_UI_IMAGE        *Image,
@@ -218,6 +352,26 @@ ComposeImage (
   IN     INTN                Ypos
   );
 
+VOID
+ComposeImageEx (
+  IN OUT NDK_UI_IMAGE        *Image,
+  IN     NDK_UI_IMAGE        *TopImage,
+  IN     INTN                Xpos,
+  IN     INTN                Ypos,
+  IN     CONST NDK_UI_BLEND  *Blend OPTIONAL
+  );
+
+VOID
+RawComposeEx (
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *CompBasePtr,
+  IN     EFI_GRAPHICS_OUTPUT_BLT_PIXEL *TopBasePtr,
+  IN     INTN                          Width,
+  IN     INTN                          Height,
+  IN     INTN                          CompLineOffset,
+  IN     INTN                          TopLineOffset,
+  IN     CONST NDK_UI_BLEND            *Blend
+  );
+
 VOID
 RawCompose (
   IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *CompBasePtr,
@@ -274,6 +428,17 @@ RawComposeColor (
   IN     INTN                          ColorDiff
   );
 
+VOID
+TileImageArea (
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *DestPtr,
+  IN     INTN                          DestLineOffset,
+  IN     INTN                          Width,
+  IN     INTN                          Height,
+  IN     NDK_UI_IMAGE                  *Pattern,
+  IN     INTN                          PatternX,
+  IN     INTN                          PatternY
+  );
+
 VOID
 FillImage (
   IN OUT NDK_UI_IMAGE                  *Image,
@@ -285,6 +450,36 @@ FreeImage (
   IN NDK_UI_IMAGE    *Image
   );
 
+UINTN
+GetImageBytesInUse (
+  VOID
+  );
+
+NDK_UI_ATLAS *
+CreateAtlas (
+  IN UINT16          SlotWidth,
+  IN UINT16          SlotHeight,
+  IN UINTN           SlotCount
+  );
+
+VOID
+FreeAtlas (
+  IN NDK_UI_ATLAS    *Atlas
+  );
+
+BOOLEAN
+AtlasAddImage (
+  IN OUT NDK_UI_ATLAS    *Atlas,
+  IN     NDK_UI_IMAGE    *Image,
+     OUT AREA_RECT       *Rect
+  );
+
+VOID
+AtlasRemoveImage (
+  IN OUT NDK_UI_ATLAS    *Atlas,
+  IN OUT AREA_RECT       *Rect
+  );
+
 /*======= NdkBootPicker.c =========*/
 
 VOID
@@ -302,9 +497,8 @@ VOID
 PrintLabel (
   IN OC_BOOT_ENTRY   *Entries,
   IN UINTN           *VisibleList,
-  IN UINTN           VisibleIndex,
-  IN INTN            Xpos,
-  IN INTN            Ypos
+  IN UINTN           FirstIndex,
+  IN UINTN           LastIndex
   );
 
 BOOLEAN
@@ -335,9 +529,755 @@ RedrawPointer (
   VOID
   );
 
+BOOLEAN
+UiBeginFrame (
+  VOID
+  );
+
+VOID
+UiEndFrame (
+  VOID
+  );
+
 VOID
 SystemReset (
   IN EFI_RESET_TYPE         ResetType
   );
 
+/*======= Animation.c =========*/
+
+#define UI_ANIMATION_MAX              8
+#define UI_ANIMATION_FRAME_RATE       60
+#define UI_FRAME_HISTORY_SIZE         64
+
+#define UI_ANIMATION_BOUNCE_TIME      100000000ULL  ///< 100 ms
+#define UI_ANIMATION_FADE_TIME        400000000ULL  ///< 400 ms
+
+//
+// Draws an animation Elapsed nanoseconds after it started, MAX_UINT64 asks it to finish.
+// Returns TRUE once the final state is drawn.
+//
+typedef
+BOOLEAN
+(*NDK_UI_ANIMATION_STEP)(
+  IN VOID                   *Context,
+  IN UINT64                 Elapsed
+  );
+
+typedef struct {
+  NDK_UI_ANIMATION_STEP     Step;
+  VOID                      *Context;
+  UINT64                    StartTime;
+} NDK_UI_ANIMATION;
+
+typedef struct {
+  UINT64                    FrameTime[UI_FRAME_HISTORY_SIZE];
+  UINT64                    TotalFrameTime;
+  UINT64                    MaxFrameTime;
+  UINTN                     FrameCount;
+  UINTN                     DroppedCount;
+} NDK_UI_FRAME_STATS;
+
+EFI_STATUS
+InitAnimation (
+  VOID
+  );
+
+VOID
+FreeAnimation (
+  VOID
+  );
+
+BOOLEAN
+StartAnimation (
+  IN NDK_UI_ANIMATION_STEP  Step,
+  IN VOID                   *Context
+  );
+
+VOID
+StopAnimation (
+  IN NDK_UI_ANIMATION_STEP  Step,
+  IN BOOLEAN                Finish
+  );
+
+BOOLEAN
+IsAnimationActive (
+  IN NDK_UI_ANIMATION_STEP  Step
+  );
+
+VOID
+AnimationTick (
+  VOID
+  );
+
+/*======= FrameBuffer.c =========*/
+
+EFI_STATUS
+InitFrameBuffer (
+  IN EFI_GRAPHICS_OUTPUT_PROTOCOL   *GraphicsOutput
+  );
+
+VOID
+FreeFrameBuffer (
+  VOID
+  );
+
+BOOLEAN
+IsFrameBufferActive (
+  VOID
+  );
+
+BOOLEAN
+FrameBufferBlt (
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Buffer,
+  IN UINTN                          BufferWidth,
+  IN INTN                           AreaXpos,
+  IN INTN                           AreaYpos,
+  IN INTN                           ScreenXpos,
+  IN INTN                           ScreenYpos,
+  IN INTN                           AreaWidth,
+  IN INTN                           AreaHeight
+  );
+
+/*======= GopStats.c =========*/
+
+#define UI_GOP_STATS_FILE             L"GopStats.csv"
+#define UI_GOP_REPORT_LINE            192
+#define UI_GOP_FRAME_AVERAGE          16
+
+typedef enum {
+  UiGopOther,
+  UiGopPresent,
+  UiGopClearScreen,
+  UiGopDrawMenu,
+  UiGopScrollMenu,
+  UiGopSwitchIcon,
+  UiGopPrintLabel,
+  UiGopDateTime,
+  UiGopTimeOut,
+  UiGopPrintText,
+  UiGopToolBar,
+  UiGopPointer,
+  UiGopHud,
+  UiGopCallerMax
+} NDK_UI_GOP_CALLER;
+
+typedef struct {
+  UINT64                          Calls;
+  UINT64                          PixelsDrawn;
+  UINT64                          PixelsTaken;
+  UINT64                          BltCalls;
+  UINT64                          PixelsToVideo;
+  UINT64                          PixelsFromVideo;
+  UINT64                          BltTicks;
+  UINT64                          FrameTicks;
+} NDK_UI_GOP_COUNTERS;
+
+VOID
+ResetGopStats (
+  VOID
+  );
+
+NDK_UI_GOP_CALLER
+GopEnterCaller (
+  IN NDK_UI_GOP_CALLER  Caller
+  );
+
+VOID
+GopLeaveCaller (
+  IN NDK_UI_GOP_CALLER  Previous
+  );
+
+VOID
+GopCountDraw (
+  IN UINTN             Pixels
+  );
+
+VOID
+GopCountTake (
+  IN UINTN             Pixels
+  );
+
+UINT64
+GopBltBegin (
+  VOID
+  );
+
+VOID
+GopBltEnd (
+  IN UINT64            Start,
+  IN UINTN             PixelsToVideo,
+  IN UINTN             PixelsFromVideo
+  );
+
+VOID
+GopBeginFrame (
+  VOID
+  );
+
+VOID
+GopEndFrame (
+  VOID
+  );
+
+NDK_UI_GOP_COUNTERS *
+GetGopLastFrame (
+  VOID
+  );
+
+UINT64
+GetGopAverageFrameTicks (
+  VOID
+  );
+
+UINT64
+GetGopLastBltTicks (
+  VOID
+  );
+
+CHAR8 *
+GopStatsReport (
+  OUT UINTN            *ReportSize
+  );
+
+/*======= Timeline.c =========*/
+
+#define UI_TIMELINE_FILE              L"Timeline.csv"
+#define UI_TIMELINE_MAX               96
+#define UI_TIMELINE_DETAIL            40
+#define UI_TIMELINE_LINE              112
+
+typedef struct {
+  CONST CHAR8                     *Stage;
+  CHAR8                           Detail[UI_TIMELINE_DETAIL];
+  UINT64                          Ticks;
+} NDK_UI_TIMELINE_MARK;
+
+VOID
+ResetTimeline (
+  VOID
+  );
+
+VOID
+TimelineMark (
+  IN CONST CHAR8       *Stage,
+  IN CONST CHAR16      *Detail OPTIONAL
+  );
+
+CHAR8 *
+TimelineReport (
+  OUT UINTN            *ReportSize
+  );
+
+/*======= Latency.c =========*/
+
+#define UI_LATENCY_FILE               L"Latency.csv"
+#define UI_LATENCY_BUCKETS            10
+#define UI_LATENCY_LINE               160
+
+typedef enum {
+  UiInputArrow,
+  UiInputIndex,
+  UiInputTab,
+  UiInputHover,
+  UiInputClick,
+  UiInputEventMax
+} NDK_UI_INPUT_EVENT;
+
+//
+// Bucket 0 counts latencies under 1 ms, each following bucket doubles the limit.
+//
+typedef struct {
+  UINT32                          Buckets[UI_LATENCY_BUCKETS];
+  UINT32                          Count;
+  UINT64                          Total;
+  UINT64                          Max;
+} NDK_UI_LATENCY_HISTOGRAM;
+
+VOID
+ResetLatency (
+  VOID
+  );
+
+VOID
+LatencyBegin (
+  IN NDK_UI_INPUT_EVENT  Event,
+  IN UINT64              InputTicks
+  );
+
+VOID
+LatencyEnd (
+  IN UINT64              LastBltTicks
+  );
+
+CHAR8 *
+LatencyReport (
+  OUT UINTN            *ReportSize
+  );
+
+/*======= Profile.c =========*/
+
+#define UI_PROFILE_FILE               L"Profile.csv"
+#define UI_PROFILE_LINE               128
+
+typedef enum {
+  UiProfileDecodePng,
+  UiProfileCopyScaledImage,
+  UiProfileScaleBackground,
+  UiProfileRawCompose,
+  UiProfileRawComposeOnFlat,
+  UiProfileRawComposeAlpha,
+  UiProfileRawComposeColor,
+  UiProfileRenderText,
+  UiProfileCreateTextImage,
+  UiProfileCreateIcon,
+  UiProfileCreateMenu,
+  UiProfileDrawImageArea,
+  UiProfileScaleComposeArea,
+  UiProfileMax
+} NDK_UI_PROFILE_ID;
+
+typedef struct {
+  UINT64                          Start;
+  UINT64                          Count;
+  UINT64                          Total;
+  UINT64                          Min;
+  UINT64                          Max;
+  UINTN                           Depth;
+} NDK_UI_PROFILE_SCOPE;
+
+//
+// Profiling scopes only exist in DEBUG and NOOPT builds.
+//
+#ifdef MDEPKG_NDEBUG
+#define UI_PROFILE_BEGIN(Id)
+#define UI_PROFILE_END(Id)
+#else
+#define UI_PROFILE_BEGIN(Id)          ProfileBegin (Id)
+#define UI_PROFILE_END(Id)            ProfileEnd (Id)
+
+VOID
+ProfileBegin (
+  IN NDK_UI_PROFILE_ID  Id
+  );
+
+VOID
+ProfileEnd (
+  IN NDK_UI_PROFILE_ID  Id
+  );
+
+CHAR8 *
+ProfileReport (
+  OUT UINTN            *ReportSize
+  );
+#endif
+
+VOID
+ResetProfile (
+  VOID
+  );
+
+/*======= VirtualDisplay.c =========*/
+
+#define UI_VIRTUAL_DEFAULT_WIDTH      1920
+#define UI_VIRTUAL_DEFAULT_HEIGHT     1080
+#define UI_VIRTUAL_MAX_SIZE           8192
+
+//
+// Layout of the UIVirtualDisplay variable.
+//
+typedef struct {
+  UINT32                          Width;
+  UINT32                          Height;
+  UINT32                          PixelFormat;
+  UINT32                          DumpFrames;
+} NDK_UI_VIRTUAL_CONFIG;
+
+typedef struct {
+  UINT64                          BltCalls;
+  UINT64                          PixelsWritten;
+  UINT64                          PixelsRead;
+  UINT32                          DumpFrames;
+  UINT32                          FramesDumped;
+} NDK_UI_VIRTUAL_STATS;
+
+EFI_GRAPHICS_OUTPUT_PROTOCOL *
+InitVirtualDisplay (
+  IN BOOLEAN           Force
+  );
+
+VOID
+FreeVirtualDisplay (
+  VOID
+  );
+
+BOOLEAN
+IsVirtualDisplay (
+  IN EFI_GRAPHICS_OUTPUT_PROTOCOL  *GraphicsOutput
+  );
+
+NDK_UI_VIRTUAL_STATS *
+GetVirtualDisplayStats (
+  VOID
+  );
+
+VOID
+CaptureVirtualDisplay (
+  OUT NDK_UI_IMAGE     *Image
+  );
+
+/*======= TiledImage.c =========*/
+
+#define UI_TILE_SIZE                  64
+#define UI_TILE_CACHE_SIZE            16
+
+typedef enum {
+  UiTileFormatSolid,
+  UiTileFormatRle,
+  UiTileFormatRaw,
+  UiTileFormatMax
+} NDK_UI_TILE_FORMAT;
+
+typedef struct {
+  UINT32                          Format;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL   Color;
+  UINTN                           Offset;
+  UINTN                           Size;
+} NDK_UI_IMAGE_TILE;
+
+typedef struct {
+  UINT16                          Width;
+  UINT16                          Height;
+  UINTN                           TilesX;
+  UINTN                           TilesY;
+  NDK_UI_IMAGE_TILE               *Tiles;
+  UINT32                          *Data;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL   *Cache;
+  UINTN                           CacheTile[UI_TILE_CACHE_SIZE];
+  UINT64                          CacheUse[UI_TILE_CACHE_SIZE];
+  UINT64                          Clock;
+} NDK_UI_TILED_IMAGE;
+
+NDK_UI_TILED_IMAGE *
+CreateFilledTiledImage (
+  IN UINT16                         Width,
+  IN UINT16                         Height,
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Color
+  );
+
+NDK_UI_TILED_IMAGE *
+CreateTiledImage (
+  IN NDK_UI_IMAGE                   *Image
+  );
+
+VOID
+FreeTiledImage (
+  IN NDK_UI_TILED_IMAGE             *Tiled
+  );
+
+EFI_GRAPHICS_OUTPUT_BLT_PIXEL *
+GetTilePixels (
+  IN  NDK_UI_TILED_IMAGE            *Tiled,
+  IN  UINTN                         TileIndex,
+  OUT UINTN                         *LineOffset
+  );
+
+VOID
+CopyTiledImageArea (
+  IN     NDK_UI_TILED_IMAGE            *Tiled,
+  IN     INTN                          Xpos,
+  IN     INTN                          Ypos,
+  IN     INTN                          Width,
+  IN     INTN                          Height,
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *DestBasePtr,
+  IN     INTN                          DestLineOffset
+  );
+
+/*======= ImageSlab.c =========*/
+
+#define UI_SLAB_CLASS_MAX             8
+#define UI_SLAB_CHUNK_MAX             8
+#define UI_SLAB_CHUNK_SIZE            SIZE_256KB
+#define UI_SLAB_ALIGNMENT             64
+
+typedef struct {
+  UINTN                           Pixels;
+  UINTN                           ObjectSize;
+  UINTN                           ObjectsPerChunk;
+  UINTN                           ChunkPages;
+  VOID                            *Chunks[UI_SLAB_CHUNK_MAX];
+  UINTN                           ChunkCount;
+  VOID                            *FreeList;
+  UINTN                           Live;
+  UINTN                           PeakLive;
+  UINT64                          Served;
+} NDK_UI_SLAB_CLASS;
+
+VOID
+ConfigureImageSlabs (
+  IN CONST UINTN     *Pixels,
+  IN UINTN           Count
+  );
+
+EFI_GRAPHICS_OUTPUT_BLT_PIXEL *
+AllocateSlabBitmap (
+  IN UINTN           Pixels
+  );
+
+BOOLEAN
+FreeSlabBitmap (
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Bitmap
+  );
+
+VOID
+FreeImageSlabs (
+  VOID
+  );
+
+/*======= AssetCache.c =========*/
+
+#define UI_ASSET_CACHE_MAX            16
+#define UI_MEMORY_BUDGET_DEFAULT      128
+
+typedef struct {
+  CONST CHAR16                    *Path;
+  NDK_UI_IMAGE                    *Image;
+  NDK_UI_MIP_CHAIN                Mips;
+  UINTN                           Refs;
+  UINT64                          LastUse;
+} NDK_UI_ASSET;
+
+VOID
+InitMemoryBudget (
+  VOID
+  );
+
+UINTN
+GetMemoryBudget (
+  VOID
+  );
+
+BOOLEAN
+ReserveImageBytes (
+  IN UINTN           Bytes
+  );
+
+NDK_UI_IMAGE *
+FindAsset (
+  IN CONST CHAR16    *Path
+  );
+
+VOID
+PrepareAssetMips (
+  IN  NDK_UI_IMAGE      *Image,
+  OUT NDK_UI_MIP_CHAIN  *Mips
+  );
+
+VOID
+AddAssetChain (
+  IN CONST CHAR16       *Path,
+  IN NDK_UI_MIP_CHAIN   *Mips
+  );
+
+VOID
+AddAsset (
+  IN CONST CHAR16    *Path,
+  IN NDK_UI_IMAGE    *Image
+  );
+
+VOID
+ReleaseAsset (
+  IN NDK_UI_IMAGE    *Image
+  );
+
+NDK_UI_IMAGE *
+CopyScaledAsset (
+  IN NDK_UI_IMAGE    *Image,
+  IN INTN            Ratio
+  );
+
+VOID
+FreeAssetCache (
+  VOID
+  );
+
+/*======= IconCache.c =========*/
+
+#define UI_ICON_CACHE_SIGNATURE       SIGNATURE_32 ('N', 'D', 'K', 'I')
+#define UI_ICON_CACHE_VERSION         1
+#define UI_ICON_CACHE_MAX             32
+#define UI_ICON_CACHE_PATH_MAX        64
+#define UI_ICON_CACHE_FILE            L"EFI\\OC\\Icons\\IconCache%u.bin"
+
+typedef struct {
+  UINT64                          Size;
+  EFI_TIME                        Time;
+} NDK_UI_FILE_STAMP;
+
+typedef struct {
+  CHAR16                          Path[UI_ICON_CACHE_PATH_MAX];
+  NDK_UI_FILE_STAMP               Stamp;
+  UINT16                          SourceWidth;
+  UINT16                          Ratio;
+  UINT16                          Ypos;
+  UINT16                          Width;
+  UINT16                          Height;
+  UINT16                          Reserved[3];
+} NDK_UI_ICON_CACHE_ENTRY;
+
+typedef struct {
+  UINT32                          Signature;
+  UINT32                          Version;
+  UINT32                          UiScale;
+  UINT32                          ScreenHeight;
+  UINT32                          EntryCount;
+  UINT16                          Width;
+  UINT16                          Height;
+} NDK_UI_ICON_CACHE_HEADER;
+
+VOID
+InitIconCache (
+  IN VOID            *Buffer OPTIONAL,
+  IN UINTN           BufferSize,
+  IN UINT32          UiScale,
+  IN UINT32          ScreenHeight
+  );
+
+NDK_UI_ICON_CACHE_ENTRY *
+FindCachedIcon (
+  IN CONST CHAR16     *Path,
+  IN NDK_UI_FILE_STAMP *Stamp
+  );
+
+NDK_UI_IMAGE *
+CopyCachedIcon (
+  IN NDK_UI_ICON_CACHE_ENTRY *Entry,
+  IN INTN                    Ratio
+  );
+
+VOID
+StoreCachedIcon (
+  IN CONST CHAR16     *Path,
+  IN NDK_UI_FILE_STAMP *Stamp,
+  IN UINT16           SourceWidth,
+  IN INTN             Ratio,
+  IN NDK_UI_IMAGE     *Image
+  );
+
+VOID *
+IconCacheData (
+  OUT UINTN           *DataSize
+  );
+
+UINT32
+GetIconCacheScale (
+  VOID
+  );
+
+VOID
+FreeIconCache (
+  VOID
+  );
+
+/*======= AssetLoader.c =========*/
+
+#define UI_LOAD_QUEUE_SIZE            16
+#define UI_LOAD_ASSETS_MAX            24
+
+typedef struct {
+  CONST CHAR16                    *Path;
+  NDK_UI_MIP_CHAIN                Mips;
+} NDK_UI_LOAD_JOB;
+
+VOID
+StartAssetLoader (
+  VOID
+  );
+
+VOID
+QueueLoadJob (
+  IN NDK_UI_LOAD_JOB *Job
+  );
+
+VOID
+StopAssetLoader (
+  VOID
+  );
+
+VOID
+ReleaseAssetLoader (
+  VOID
+  );
+
+/*======= AllocTrack.c =========*/
+
+#define UI_ALLOC_TRACK_MAX            1024
+#define UI_ALLOC_SITE_MAX             256
+#define UI_ALLOC_TRACK_LINE           256
+#define UI_ALLOC_TRACK_FILE           L"Allocations.csv"
+
+typedef struct {
+  CONST CHAR8                     *File;
+  UINT32                          Line;
+  UINTN                           Allocations;
+  UINTN                           Live;
+  UINTN                           LiveBytes;
+  UINTN                           PeakBytes;
+} NDK_UI_ALLOC_SITE;
+
+typedef struct {
+  VOID                            *Buffer;
+  UINTN                           Size;
+  NDK_UI_ALLOC_SITE               *Site;
+} NDK_UI_ALLOCATION;
+
+typedef struct {
+  UINTN                           Allocations;
+  UINTN                           Frees;
+  UINTN                           Untracked;
+  UINTN                           BytesInUse;
+  UINTN                           PeakBytes;
+} NDK_UI_ALLOC_STATS;
+
+CHAR8 *
+AllocationReport (
+  OUT UINTN            *ReportSize
+  );
+
+//
+// DEBUG and NOOPT builds route pool and image allocations through the tracker
+// so every buffer is booked to its call site. This has to stay the last section.
+//
+#ifndef MDEPKG_NDEBUG
+VOID *
+TrackAllocatePool (
+  IN UINTN             Size,
+  IN BOOLEAN           Zero,
+  IN CONST CHAR8       *File,
+  IN UINT32            Line
+  );
+
+VOID
+TrackFreePool (
+  IN VOID              *Buffer
+  );
+
+NDK_UI_IMAGE *
+TrackCreateImage (
+  IN UINT16            Width,
+  IN UINT16            Height,
+  IN BOOLEAN           IsAlpha,
+  IN CONST CHAR8       *File,
+  IN UINT32            Line
+  );
+
+#ifndef UI_ALLOC_TRACK_INTERNAL
+#define AllocatePool(Size)            TrackAllocatePool (Size, FALSE, __FILE__, __LINE__)
+#define AllocateZeroPool(Size)        TrackAllocatePool (Size, TRUE, __FILE__, __LINE__)
+#define FreePool(Buffer)              TrackFreePool (Buffer)
+#define CreateImage(Width, Height, IsAlpha) \
+  TrackCreateImage (Width, Height, IsAlpha, __FILE__, __LINE__)
+#endif
+#endif
+
 #endif /* NdkBootPicker_h */
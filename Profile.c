@@ -0,0 +1,124 @@
+//
+//  Profile.c
+//
+
+#include <NdkBootPicker.h>
+
+#ifndef MDEPKG_NDEBUG
+
+STATIC
+CONST CHAR8 *
+mProfileNames[UiProfileMax] = {
+  "DecodePNG",
+  "CopyScaledImage",
+  "ScaleBackgroundImage",
+  "RawCompose",
+  "RawComposeOnFlat",
+  "RawComposeAlpha",
+  "RawComposeColor",
+  "RenderText",
+  "CreateTextImage",
+  "CreateIcon",
+  "CreateMenu",
+  "DrawImageArea",
+  "ScaleComposeArea"
+};
+
+STATIC
+NDK_UI_PROFILE_SCOPE
+mProfile[UiProfileMax];
+
+#endif
+
+VOID
+ResetProfile (
+  VOID
+  )
+{
+#ifndef MDEPKG_NDEBUG
+  ZeroMem (mProfile, sizeof (mProfile));
+#endif
+}
+
+#ifndef MDEPKG_NDEBUG
+
+
+VOID
+ProfileBegin (
+  IN NDK_UI_PROFILE_ID  Id
+  )
+{
+  //
+  // Only the outermost entry of a scope is timed.
+  //
+  if (mProfile[Id].Depth++ == 0) {
+    mProfile[Id].Start = GetPerformanceCounter ();
+  }
+}
+
+VOID
+ProfileEnd (
+  IN NDK_UI_PROFILE_ID  Id
+  )
+{
+  NDK_UI_PROFILE_SCOPE  *Scope;
+  UINT64                Ticks;
+  
+  Scope = &mProfile[Id];
+  if (Scope->Depth == 0 || --Scope->Depth != 0) {
+    return;
+  }
+  
+  Ticks = GetPerformanceCounter () - Scope->Start;
+  if (Scope->Count == 0 || Ticks < Scope->Min) {
+    Scope->Min = Ticks;
+  }
+  Scope->Max = MAX (Scope->Max, Ticks);
+  Scope->Total += Ticks;
+  ++Scope->Count;
+}
+
+CHAR8 *
+ProfileReport (
+  OUT UINTN            *ReportSize
+  )
+{
+  CHAR8                *Report;
+  UINTN                BufferSize;
+  UINTN                Length;
+  UINTN                Index;
+  UINTN                LineStart;
+  
+  *ReportSize = 0;
+  BufferSize = (UiProfileMax + 1) * UI_PROFILE_LINE;
+  Report = AllocateZeroPool (BufferSize);
+  if (Report == NULL) {
+    return NULL;
+  }
+  
+  Length = AsciiSPrint (Report, BufferSize, "Scope,Calls,TotalMicroSeconds,MinNanoSeconds,MaxNanoSeconds\n");
+  
+  for (Index = 0; Index < UiProfileMax; ++Index) {
+    if (mProfile[Index].Count == 0) {
+      continue;
+    }
+    
+    LineStart = Length;
+    Length += AsciiSPrint (Report + Length,
+                           BufferSize - Length,
+                           "%a,%lu,%lu,%lu,%lu\n",
+                           mProfileNames[Index],
+                           mProfile[Index].Count,
+                           DivU64x32 (GetTimeInNanoSecond (mProfile[Index].Total), 1000),
+                           GetTimeInNanoSecond (mProfile[Index].Min),
+                           GetTimeInNanoSecond (mProfile[Index].Max)
+                           );
+    DEBUG ((DEBUG_INFO, "OCUI: Profile %a", Report + LineStart));
+  }
+  
+  *ReportSize = Length;
+  
+  return Report;
+}
+
+#endif
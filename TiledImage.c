@@ -0,0 +1,399 @@
+//
+//  TiledImage.c
+//
+
+#include <NdkBootPicker.h>
+
+//
+// Rle tiles are a list of rows. A row is either a single zero, repeating the row above,
+// or runs of a count followed by a pixel.
+//
+STATIC
+UINTN
+EncodeTile (
+  IN  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Src,
+  IN  UINTN                         SrcLineOffset,
+  IN  UINTN                         Width,
+  IN  UINTN                         Height,
+  OUT UINT32                        *Data OPTIONAL
+  )
+{
+  UINTN                             Units;
+  UINTN                             X;
+  UINTN                             Y;
+  UINTN                             Run;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL     *Row;
+  
+  Units = 0;
+  for (Y = 0; Y < Height; ++Y) {
+    Row = Src + Y * SrcLineOffset;
+    if (Y > 0 && CompareMem (Row, Row - SrcLineOffset, Width * sizeof (*Row)) == 0) {
+      if (Data != NULL) {
+        Data[Units] = 0;
+      }
+      ++Units;
+      continue;
+    }
+  
+    for (X = 0; X < Width; X += Run) {
+      Run = 1;
+      while (X + Run < Width && *(UINT32 *) &Row[X + Run] == *(UINT32 *) &Row[X]) {
+        ++Run;
+      }
+      if (Data != NULL) {
+        Data[Units] = (UINT32) Run;
+        Data[Units + 1] = *(UINT32 *) &Row[X];
+      }
+      Units += 2;
+    }
+  }
+  
+  return Units;
+}
+
+STATIC
+VOID
+DecodeTile (
+  IN  UINT32                        *Data,
+  IN  UINTN                         Width,
+  IN  UINTN                         Height,
+  OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Dest
+  )
+{
+  UINTN                             X;
+  UINTN                             Y;
+  UINT32                            Run;
+  UINT32                            *Pixel;
+  
+  Pixel = (UINT32 *) Dest;
+  for (Y = 0; Y < Height; ++Y) {
+    if (*Data == 0) {
+      CopyMem (Pixel, Pixel - Width, Width * sizeof (*Pixel));
+      Pixel += Width;
+      ++Data;
+      continue;
+    }
+  
+    for (X = 0; X < Width; X += Run) {
+      Run = *Data++;
+      SetMem32 (Pixel, Run * sizeof (*Pixel), *Data++);
+      Pixel += Run;
+    }
+  }
+}
+
+STATIC
+BOOLEAN
+IsSolidTile (
+  IN  EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Src,
+  IN  UINTN                         SrcLineOffset,
+  IN  UINTN                         Width,
+  IN  UINTN                         Height
+  )
+{
+  UINTN                             X;
+  UINTN                             Y;
+  
+  for (Y = 0; Y < Height; ++Y) {
+    for (X = 0; X < Width; ++X) {
+      if (*(UINT32 *) &Src[Y * SrcLineOffset + X] != *(UINT32 *) Src) {
+        return FALSE;
+      }
+    }
+  }
+  
+  return TRUE;
+}
+
+STATIC
+NDK_UI_TILED_IMAGE *
+AllocateTiledImage (
+  IN UINT16                         Width,
+  IN UINT16                         Height
+  )
+{
+  NDK_UI_TILED_IMAGE                *Tiled;
+  
+  if (Width == 0 || Height == 0) {
+    return NULL;
+  }
+  
+  Tiled = AllocateZeroPool (sizeof (NDK_UI_TILED_IMAGE));
+  if (Tiled == NULL) {
+    return NULL;
+  }
+  
+  Tiled->Width = Width;
+  Tiled->Height = Height;
+  Tiled->TilesX = (Width + UI_TILE_SIZE - 1) / UI_TILE_SIZE;
+  Tiled->TilesY = (Height + UI_TILE_SIZE - 1) / UI_TILE_SIZE;
+  Tiled->Tiles = AllocateZeroPool (Tiled->TilesX * Tiled->TilesY * sizeof (NDK_UI_IMAGE_TILE));
+  if (Tiled->Tiles == NULL) {
+    FreePool (Tiled);
+    return NULL;
+  }
+  
+  SetMem (Tiled->CacheTile, sizeof (Tiled->CacheTile), 0xFF);
+  return Tiled;
+}
+
+NDK_UI_TILED_IMAGE *
+CreateFilledTiledImage (
+  IN UINT16                         Width,
+  IN UINT16                         Height,
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Color
+  )
+{
+  NDK_UI_TILED_IMAGE                *Tiled;
+  UINTN                             Index;
+  
+  Tiled = AllocateTiledImage (Width, Height);
+  if (Tiled == NULL) {
+    return NULL;
+  }
+  
+  for (Index = 0; Index < Tiled->TilesX * Tiled->TilesY; ++Index) {
+    Tiled->Tiles[Index].Format = UiTileFormatSolid;
+    Tiled->Tiles[Index].Color = *Color;
+  }
+  
+  return Tiled;
+}
+
+NDK_UI_TILED_IMAGE *
+CreateTiledImage (
+  IN NDK_UI_IMAGE                   *Image
+  )
+{
+  NDK_UI_TILED_IMAGE                *Tiled;
+  NDK_UI_IMAGE_TILE                 *Tile;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL     *Src;
+  UINTN                             TileX;
+  UINTN                             TileY;
+  UINTN                             Width;
+  UINTN                             Height;
+  UINTN                             Units;
+  UINTN                             Counts[UiTileFormatMax];
+  
+  if (Image == NULL) {
+    return NULL;
+  }
+  
+  Tiled = AllocateTiledImage (Image->Width, Image->Height);
+  if (Tiled == NULL) {
+    return NULL;
+  }
+  
+  //
+  // The first pass picks the cheapest format of every tile, the second one fills a single data block.
+  //
+  ZeroMem (Counts, sizeof (Counts));
+  Units = 0;
+  for (TileY = 0; TileY < Tiled->TilesY; ++TileY) {
+    for (TileX = 0; TileX < Tiled->TilesX; ++TileX) {
+      Tile = &Tiled->Tiles[TileY * Tiled->TilesX + TileX];
+      Src = Image->Bitmap + TileY * UI_TILE_SIZE * Image->Width + TileX * UI_TILE_SIZE;
+      Width = MIN (UI_TILE_SIZE, Image->Width - TileX * UI_TILE_SIZE);
+      Height = MIN (UI_TILE_SIZE, Image->Height - TileY * UI_TILE_SIZE);
+  
+      if (IsSolidTile (Src, Image->Width, Width, Height)) {
+        Tile->Format = UiTileFormatSolid;
+        Tile->Color = *Src;
+      } else {
+        Tile->Size = EncodeTile (Src, Image->Width, Width, Height, NULL);
+        if (Tile->Size < Width * Height) {
+          Tile->Format = UiTileFormatRle;
+        } else {
+          Tile->Format = UiTileFormatRaw;
+          Tile->Size = Width * Height;
+        }
+        Tile->Offset = Units;
+        Units += Tile->Size;
+      }
+      ++Counts[Tile->Format];
+    }
+  }
+  
+  if (Units > 0) {
+    Tiled->Data = AllocatePool (Units * sizeof (UINT32));
+    if (Tiled->Data == NULL) {
+      FreeTiledImage (Tiled);
+      return NULL;
+    }
+  }
+  
+  if (Counts[UiTileFormatRle] > 0) {
+    Tiled->Cache = AllocatePool (UI_TILE_CACHE_SIZE * UI_TILE_SIZE * UI_TILE_SIZE * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    if (Tiled->Cache == NULL) {
+      FreeTiledImage (Tiled);
+      return NULL;
+    }
+  }
+  
+  for (TileY = 0; TileY < Tiled->TilesY; ++TileY) {
+    for (TileX = 0; TileX < Tiled->TilesX; ++TileX) {
+      Tile = &Tiled->Tiles[TileY * Tiled->TilesX + TileX];
+      Src = Image->Bitmap + TileY * UI_TILE_SIZE * Image->Width + TileX * UI_TILE_SIZE;
+      Width = MIN (UI_TILE_SIZE, Image->Width - TileX * UI_TILE_SIZE);
+      Height = MIN (UI_TILE_SIZE, Image->Height - TileY * UI_TILE_SIZE);
+  
+      if (Tile->Format == UiTileFormatRle) {
+        EncodeTile (Src, Image->Width, Width, Height, Tiled->Data + Tile->Offset);
+      } else if (Tile->Format == UiTileFormatRaw) {
+        RawCopy ((EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (Tiled->Data + Tile->Offset), Src, Width, Height, Width, Image->Width);
+      }
+    }
+  }
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Tiled image %ux%u - solid %u, rle %u, raw %u, %u bytes\n",
+          Image->Width,
+          Image->Height,
+          (UINT32) Counts[UiTileFormatSolid],
+          (UINT32) Counts[UiTileFormatRle],
+          (UINT32) Counts[UiTileFormatRaw],
+          (UINT32) (Units * sizeof (UINT32))
+          ));
+  
+  return Tiled;
+}
+
+VOID
+FreeTiledImage (
+  IN NDK_UI_TILED_IMAGE             *Tiled
+  )
+{
+  if (Tiled == NULL) {
+    return;
+  }
+  
+  if (Tiled->Cache != NULL) {
+    FreePool (Tiled->Cache);
+  }
+  if (Tiled->Data != NULL) {
+    FreePool (Tiled->Data);
+  }
+  FreePool (Tiled->Tiles);
+  FreePool (Tiled);
+}
+
+EFI_GRAPHICS_OUTPUT_BLT_PIXEL *
+GetTilePixels (
+  IN  NDK_UI_TILED_IMAGE            *Tiled,
+  IN  UINTN                         TileIndex,
+  OUT UINTN                         *LineOffset
+  )
+{
+  NDK_UI_IMAGE_TILE                 *Tile;
+  UINTN                             Slot;
+  UINTN                             Index;
+  
+  Tile = &Tiled->Tiles[TileIndex];
+  *LineOffset = MIN (UI_TILE_SIZE, Tiled->Width - (TileIndex % Tiled->TilesX) * UI_TILE_SIZE);
+  
+  if (Tile->Format == UiTileFormatSolid) {
+    return NULL;
+  }
+  
+  if (Tile->Format == UiTileFormatRaw) {
+    return (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (Tiled->Data + Tile->Offset);
+  }
+  
+  //
+  // Rle tiles go through a small cache, the least recently used slot is replaced.
+  //
+  ++Tiled->Clock;
+  Slot = 0;
+  for (Index = 0; Index < UI_TILE_CACHE_SIZE; ++Index) {
+    if (Tiled->CacheTile[Index] == TileIndex) {
+      Tiled->CacheUse[Index] = Tiled->Clock;
+      return Tiled->Cache + Index * UI_TILE_SIZE * UI_TILE_SIZE;
+    }
+    if (Tiled->CacheUse[Index] < Tiled->CacheUse[Slot]) {
+      Slot = Index;
+    }
+  }
+  
+  DecodeTile (Tiled->Data + Tile->Offset,
+              *LineOffset,
+              MIN (UI_TILE_SIZE, Tiled->Height - (TileIndex / Tiled->TilesX) * UI_TILE_SIZE),
+              Tiled->Cache + Slot * UI_TILE_SIZE * UI_TILE_SIZE
+              );
+  Tiled->CacheTile[Slot] = TileIndex;
+  Tiled->CacheUse[Slot] = Tiled->Clock;
+  return Tiled->Cache + Slot * UI_TILE_SIZE * UI_TILE_SIZE;
+}
+
+VOID
+CopyTiledImageArea (
+  IN     NDK_UI_TILED_IMAGE            *Tiled,
+  IN     INTN                          Xpos,
+  IN     INTN                          Ypos,
+  IN     INTN                          Width,
+  IN     INTN                          Height,
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *DestBasePtr,
+  IN     INTN                          DestLineOffset
+  )
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *Src;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *Dest;
+  NDK_UI_IMAGE_TILE                    *Tile;
+  UINTN                                LineOffset;
+  INTN                                 TileX;
+  INTN                                 TileY;
+  INTN                                 Left;
+  INTN                                 Top;
+  INTN                                 Right;
+  INTN                                 Bottom;
+  INTN                                 Row;
+  
+  if (Tiled == NULL || DestBasePtr == NULL) {
+    return;
+  }
+  
+  if (Xpos < 0) {
+    DestBasePtr -= Xpos;
+    Width += Xpos;
+    Xpos = 0;
+  }
+  if (Ypos < 0) {
+    DestBasePtr -= Ypos * DestLineOffset;
+    Height += Ypos;
+    Ypos = 0;
+  }
+  Width = MIN (Width, (INTN) Tiled->Width - Xpos);
+  Height = MIN (Height, (INTN) Tiled->Height - Ypos);
+  if (Width <= 0 || Height <= 0) {
+    return;
+  }
+  
+  //
+  // Every tile touched by the area is looked up once and copied as a whole rectangle.
+  //
+  for (TileY = Ypos / UI_TILE_SIZE; TileY * UI_TILE_SIZE < Ypos + Height; ++TileY) {
+    Top = MAX (Ypos, TileY * UI_TILE_SIZE);
+    Bottom = MIN (Ypos + Height, (TileY + 1) * UI_TILE_SIZE);
+    for (TileX = Xpos / UI_TILE_SIZE; TileX * UI_TILE_SIZE < Xpos + Width; ++TileX) {
+      Left = MAX (Xpos, TileX * UI_TILE_SIZE);
+      Right = MIN (Xpos + Width, (TileX + 1) * UI_TILE_SIZE);
+      Dest = DestBasePtr + (Top - Ypos) * DestLineOffset + (Left - Xpos);
+      Tile = &Tiled->Tiles[TileY * Tiled->TilesX + TileX];
+  
+      Src = GetTilePixels (Tiled, TileY * Tiled->TilesX + TileX, &LineOffset);
+      if (Src == NULL) {
+        for (Row = Top; Row < Bottom; ++Row) {
+          SetMem32 (Dest, (Right - Left) * sizeof (*Dest), *(UINT32 *) &Tile->Color);
+          Dest += DestLineOffset;
+        }
+        continue;
+      }
+  
+      RawCopy (Dest,
+               Src + (Top - TileY * UI_TILE_SIZE) * LineOffset + (Left - TileX * UI_TILE_SIZE),
+               Right - Left,
+               Bottom - Top,
+               DestLineOffset,
+               LineOffset
+               );
+    }
+  }
+}
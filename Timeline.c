@@ -0,0 +1,96 @@
+//
+//  Timeline.c
+//
+
+#include <NdkBootPicker.h>
+
+STATIC
+NDK_UI_TIMELINE_MARK
+mTimeline[UI_TIMELINE_MAX];
+
+STATIC
+UINTN
+mTimelineCount = 0;
+
+VOID
+ResetTimeline (
+  VOID
+  )
+{
+  mTimelineCount = 0;
+}
+
+VOID
+TimelineMark (
+  IN CONST CHAR8       *Stage,
+  IN CONST CHAR16      *Detail OPTIONAL
+  )
+{
+  NDK_UI_TIMELINE_MARK *Mark;
+  UINTN                Index;
+  
+  if (mTimelineCount >= UI_TIMELINE_MAX) {
+    return;
+  }
+  
+  Mark = &mTimeline[mTimelineCount++];
+  Mark->Ticks = GetPerformanceCounter ();
+  Mark->Stage = Stage;
+  
+  //
+  // Details end up in a CSV field, so anything that is not plain ASCII or would split the field is dropped.
+  //
+  Index = 0;
+  if (Detail != NULL) {
+    for (; *Detail != L'\0' && Index < UI_TIMELINE_DETAIL - 1; ++Detail) {
+      if (*Detail >= L' ' && *Detail < 0x7F && *Detail != L',' && *Detail != L'"') {
+        Mark->Detail[Index++] = (CHAR8) *Detail;
+      }
+    }
+  }
+  Mark->Detail[Index] = '\0';
+}
+
+CHAR8 *
+TimelineReport (
+  OUT UINTN            *ReportSize
+  )
+{
+  CHAR8                *Report;
+  UINTN                BufferSize;
+  UINTN                Length;
+  UINTN                Index;
+  UINT64               Start;
+  UINT64               Previous;
+  
+  *ReportSize = 0;
+  if (mTimelineCount == 0) {
+    return NULL;
+  }
+  
+  BufferSize = (mTimelineCount + 1) * UI_TIMELINE_LINE;
+  Report = AllocateZeroPool (BufferSize);
+  if (Report == NULL) {
+    return NULL;
+  }
+  
+  Length = AsciiSPrint (Report, BufferSize, "Stage,Detail,MicroSeconds,DeltaMicroSeconds\n");
+  
+  Start = GetTimeInNanoSecond (mTimeline[0].Ticks);
+  Previous = Start;
+  for (Index = 0; Index < mTimelineCount; ++Index) {
+    Length += AsciiSPrint (Report + Length,
+                           BufferSize - Length,
+                           "%a,%a,%lu,%lu\n",
+                           mTimeline[Index].Stage,
+                           mTimeline[Index].Detail,
+                           DivU64x32 (GetTimeInNanoSecond (mTimeline[Index].Ticks) - Start, 1000),
+                           DivU64x32 (GetTimeInNanoSecond (mTimeline[Index].Ticks) - Previous, 1000)
+                           );
+    Previous = GetTimeInNanoSecond (mTimeline[Index].Ticks);
+  }
+  
+  *ReportSize = Length;
+  
+  return Report;
+}
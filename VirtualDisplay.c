@@ -0,0 +1,347 @@
+//
+//  VirtualDisplay.c
+//
+
+#include <NdkBootPicker.h>
+
+STATIC
+EFI_GRAPHICS_OUTPUT_PROTOCOL
+mVirtualDisplay;
+
+STATIC
+EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE
+mVirtualMode;
+
+STATIC
+EFI_GRAPHICS_OUTPUT_MODE_INFORMATION
+mVirtualInfo;
+
+STATIC
+UINT32 *
+mVirtualBuffer = NULL;
+
+STATIC
+UINTN
+mVirtualPages;
+
+STATIC
+NDK_UI_VIRTUAL_STATS
+mVirtualStats;
+
+STATIC
+UINT32
+ToVirtualPixel (
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Pixel
+  )
+{
+  if (mVirtualInfo.PixelFormat == PixelRedGreenBlueReserved8BitPerColor) {
+    return Pixel->Red | (Pixel->Green << 8) | (Pixel->Blue << 16);
+  }
+  
+  return Pixel->Blue | (Pixel->Green << 8) | (Pixel->Red << 16);
+}
+
+STATIC
+VOID
+FromVirtualPixel (
+  IN  UINT32                         Value,
+  OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Pixel
+  )
+{
+  if (mVirtualInfo.PixelFormat == PixelRedGreenBlueReserved8BitPerColor) {
+    Pixel->Red = (UINT8) Value;
+    Pixel->Blue = (UINT8) (Value >> 16);
+  } else {
+    Pixel->Blue = (UINT8) Value;
+    Pixel->Red = (UINT8) (Value >> 16);
+  }
+  Pixel->Green = (UINT8) (Value >> 8);
+  Pixel->Reserved = 0;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+VirtualQueryMode (
+  IN  EFI_GRAPHICS_OUTPUT_PROTOCOL          *This,
+  IN  UINT32                                ModeNumber,
+  OUT UINTN                                 *SizeOfInfo,
+  OUT EFI_GRAPHICS_OUTPUT_MODE_INFORMATION  **Info
+  )
+{
+  if (ModeNumber != 0 || SizeOfInfo == NULL || Info == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  
+  *Info = AllocateCopyPool (sizeof (mVirtualInfo), &mVirtualInfo);
+  if (*Info == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  *SizeOfInfo = sizeof (mVirtualInfo);
+  
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+VirtualSetMode (
+  IN EFI_GRAPHICS_OUTPUT_PROTOCOL  *This,
+  IN UINT32                        ModeNumber
+  )
+{
+  if (ModeNumber != 0) {
+    return EFI_UNSUPPORTED;
+  }
+  
+  ZeroMem (mVirtualBuffer, mVirtualMode.FrameBufferSize);
+  
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+VirtualBlt (
+  IN EFI_GRAPHICS_OUTPUT_PROTOCOL       *This,
+  IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL      *BltBuffer OPTIONAL,
+  IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION  BltOperation,
+  IN UINTN                              SourceX,
+  IN UINTN                              SourceY,
+  IN UINTN                              DestinationX,
+  IN UINTN                              DestinationY,
+  IN UINTN                              Width,
+  IN UINTN                              Height,
+  IN UINTN                              Delta OPTIONAL
+  )
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *BltRow;
+  UINT32                         *VideoRow;
+  UINT32                         Value;
+  UINTN                          Row;
+  UINTN                          Column;
+  
+  if (Width == 0 || Height == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+  
+  if (Delta == 0) {
+    Delta = Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+  }
+  
+  if (BltOperation != EfiBltVideoToBltBuffer
+      && (DestinationX + Width > mVirtualInfo.HorizontalResolution
+        || DestinationY + Height > mVirtualInfo.VerticalResolution)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  
+  if ((BltOperation == EfiBltVideoToBltBuffer || BltOperation == EfiBltVideoToVideo)
+      && (SourceX + Width > mVirtualInfo.HorizontalResolution
+        || SourceY + Height > mVirtualInfo.VerticalResolution)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  
+  ++mVirtualStats.BltCalls;
+  
+  switch (BltOperation) {
+    case EfiBltVideoFill:
+      Value = ToVirtualPixel (BltBuffer);
+      for (Row = 0; Row < Height; ++Row) {
+        VideoRow = mVirtualBuffer + (DestinationY + Row) * mVirtualInfo.PixelsPerScanLine + DestinationX;
+        SetMem32 (VideoRow, Width * sizeof (UINT32), Value);
+      }
+      mVirtualStats.PixelsWritten += Width * Height;
+      break;
+      
+    case EfiBltVideoToBltBuffer:
+      for (Row = 0; Row < Height; ++Row) {
+        VideoRow = mVirtualBuffer + (SourceY + Row) * mVirtualInfo.PixelsPerScanLine + SourceX;
+        BltRow = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) ((UINT8 *) BltBuffer + (DestinationY + Row) * Delta) + DestinationX;
+        for (Column = 0; Column < Width; ++Column) {
+          FromVirtualPixel (VideoRow[Column], &BltRow[Column]);
+        }
+      }
+      mVirtualStats.PixelsRead += Width * Height;
+      break;
+      
+    case EfiBltBufferToVideo:
+      for (Row = 0; Row < Height; ++Row) {
+        VideoRow = mVirtualBuffer + (DestinationY + Row) * mVirtualInfo.PixelsPerScanLine + DestinationX;
+        BltRow = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) ((UINT8 *) BltBuffer + (SourceY + Row) * Delta) + SourceX;
+        for (Column = 0; Column < Width; ++Column) {
+          VideoRow[Column] = ToVirtualPixel (&BltRow[Column]);
+        }
+      }
+      mVirtualStats.PixelsWritten += Width * Height;
+      break;
+      
+    case EfiBltVideoToVideo:
+      //
+      // Rows are copied in the order that keeps overlapping areas intact.
+      //
+      for (Row = 0; Row < Height; ++Row) {
+        Column = DestinationY > SourceY ? Height - 1 - Row : Row;
+        CopyMem (mVirtualBuffer + (DestinationY + Column) * mVirtualInfo.PixelsPerScanLine + DestinationX,
+                 mVirtualBuffer + (SourceY + Column) * mVirtualInfo.PixelsPerScanLine + SourceX,
+                 Width * sizeof (UINT32)
+                 );
+      }
+      mVirtualStats.PixelsRead += Width * Height;
+      mVirtualStats.PixelsWritten += Width * Height;
+      break;
+      
+    default:
+      return EFI_INVALID_PARAMETER;
+  }
+  
+  return EFI_SUCCESS;
+}
+
+EFI_GRAPHICS_OUTPUT_PROTOCOL *
+InitVirtualDisplay (
+  IN BOOLEAN           Force
+  )
+{
+  EFI_STATUS                    Status;
+  NDK_UI_VIRTUAL_CONFIG         Config;
+  UINTN                         DataSize;
+  
+  if (mVirtualBuffer != NULL) {
+    return &mVirtualDisplay;
+  }
+  
+  DataSize = sizeof (Config);
+  
+  Status = gRT->GetVariable (
+                             UI_MENU_VIRTUAL_DISPLAY,
+                             &gAppleVendorVariableGuid,
+                             NULL,
+                             &DataSize,
+                             &Config
+                             );
+  
+  if (EFI_ERROR (Status) || DataSize != sizeof (Config)) {
+    if (!Force) {
+      return NULL;
+    }
+    Config.Width = UI_VIRTUAL_DEFAULT_WIDTH;
+    Config.Height = UI_VIRTUAL_DEFAULT_HEIGHT;
+    Config.PixelFormat = PixelBlueGreenRedReserved8BitPerColor;
+    Config.DumpFrames = 0;
+  }
+  
+  if (Config.Width == 0 || Config.Height == 0
+      || Config.Width > UI_VIRTUAL_MAX_SIZE || Config.Height > UI_VIRTUAL_MAX_SIZE
+      || Config.PixelFormat > PixelBltOnly || Config.PixelFormat == PixelBitMask) {
+    DEBUG ((DEBUG_INFO, "OCUI: Invalid virtual display setting %ux%u format %u\n",
+            Config.Width,
+            Config.Height,
+            Config.PixelFormat
+            ));
+    return NULL;
+  }
+  
+  ZeroMem (&mVirtualInfo, sizeof (mVirtualInfo));
+  mVirtualInfo.HorizontalResolution = Config.Width;
+  mVirtualInfo.VerticalResolution = Config.Height;
+  mVirtualInfo.PixelFormat = (EFI_GRAPHICS_PIXEL_FORMAT) Config.PixelFormat;
+  mVirtualInfo.PixelsPerScanLine = Config.Width;
+  
+  mVirtualPages = EFI_SIZE_TO_PAGES (Config.Width * Config.Height * sizeof (UINT32));
+  mVirtualBuffer = AllocatePages (mVirtualPages);
+  if (mVirtualBuffer == NULL) {
+    return NULL;
+  }
+  ZeroMem (mVirtualBuffer, EFI_PAGES_TO_SIZE (mVirtualPages));
+  
+  ZeroMem (&mVirtualMode, sizeof (mVirtualMode));
+  mVirtualMode.MaxMode = 1;
+  mVirtualMode.Mode = 0;
+  mVirtualMode.Info = &mVirtualInfo;
+  mVirtualMode.SizeOfInfo = sizeof (mVirtualInfo);
+  mVirtualMode.FrameBufferSize = Config.Width * Config.Height * sizeof (UINT32);
+  //
+  // Blt only displays hide their buffer, which keeps the direct frame buffer backend away.
+  //
+  if (mVirtualInfo.PixelFormat != PixelBltOnly) {
+    mVirtualMode.FrameBufferBase = (EFI_PHYSICAL_ADDRESS) (UINTN) mVirtualBuffer;
+  }
+  
+  mVirtualDisplay.QueryMode = VirtualQueryMode;
+  mVirtualDisplay.SetMode = VirtualSetMode;
+  mVirtualDisplay.Blt = VirtualBlt;
+  mVirtualDisplay.Mode = &mVirtualMode;
+  
+  ZeroMem (&mVirtualStats, sizeof (mVirtualStats));
+  mVirtualStats.DumpFrames = Config.DumpFrames;
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Virtual display %ux%u format %u\n",
+          Config.Width,
+          Config.Height,
+          Config.PixelFormat
+          ));
+  
+  return &mVirtualDisplay;
+}
+
+VOID
+FreeVirtualDisplay (
+  VOID
+  )
+{
+  if (mVirtualBuffer == NULL) {
+    return;
+  }
+  
+  DEBUG ((DEBUG_INFO, "OCUI: Virtual display %lu Blts, %lu pixels written, %lu pixels read back, %u frames dumped\n",
+          mVirtualStats.BltCalls,
+          mVirtualStats.PixelsWritten,
+          mVirtualStats.PixelsRead,
+          mVirtualStats.FramesDumped
+          ));
+  
+  FreePages (mVirtualBuffer, mVirtualPages);
+  mVirtualBuffer = NULL;
+}
+
+BOOLEAN
+IsVirtualDisplay (
+  IN EFI_GRAPHICS_OUTPUT_PROTOCOL  *GraphicsOutput
+  )
+{
+  return mVirtualBuffer != NULL && GraphicsOutput == &mVirtualDisplay;
+}
+
+NDK_UI_VIRTUAL_STATS *
+GetVirtualDisplayStats (
+  VOID
+  )
+{
+  return &mVirtualStats;
+}
+
+VOID
+CaptureVirtualDisplay (
+  OUT NDK_UI_IMAGE     *Image
+  )
+{
+  UINT32               *VideoRow;
+  UINTN                Width;
+  UINTN                Height;
+  UINTN                Row;
+  UINTN                Column;
+  
+  if (mVirtualBuffer == NULL || Image == NULL) {
+    return;
+  }
+  
+  Width = MIN (Image->Width, mVirtualInfo.HorizontalResolution);
+  Height = MIN (Image->Height, mVirtualInfo.VerticalResolution);
+  
+  for (Row = 0; Row < Height; ++Row) {
+    VideoRow = mVirtualBuffer + Row * mVirtualInfo.PixelsPerScanLine;
+    for (Column = 0; Column < Width; ++Column) {
+      FromVirtualPixel (VideoRow[Column], &Image->Bitmap[Row * Image->Width + Column]);
+    }
+  }
+}